@@ -0,0 +1,125 @@
+/**
+ * IMA ADPCM (DVI ADPCM) codec, as in WAVE format 0x11.
+ *
+ * Each 16-bit sample is coded as 4 bits: the sign and magnitude of its
+ * difference from the predicted sample (the last one decoded), in units of
+ * the current step size.  The step size then grows or shrinks through a table
+ * of 89 sizes depending on the magnitude.  The encoder keeps the decoder's
+ * state, so both see the same predictor and step.  Only shifts and additions
+ * are used: no multiplication or division.
+ *
+ * A WAVE block starts with a header holding the first sample as is and the
+ * step index (adpcm_header()), so each block decodes on its own.
+ */
+
+#ifndef _ADPCMLIB_C
+#define _ADPCMLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "adpcm.h"
+
+void adpcm_update(struct adpcmstate *, uint8_t code, uint16_t diff);
+
+/*----------------------------------------------------------------------------*/
+/* Step sizes																  */
+/*----------------------------------------------------------------------------*/
+const uint16_t adpcm_steps[ADPCM_NSTEPS] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+	45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209,
+	230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876,
+	963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749,
+	3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+	9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385,
+	24623, 27086, 29794, 32767
+};
+
+// Step index change by code magnitude (the sign bit is ignored)
+const int8_t adpcm_index_change[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/*----------------------------------------------------------------------------*/
+/* Apply a code, whose difference from the predictor is diff, to the state	  */
+/*----------------------------------------------------------------------------*/
+void adpcm_update(struct adpcmstate *st, uint8_t code, uint16_t diff) {
+	int32_t predictor = st->predictor;
+	int8_t index;
+
+	if (code & 8) predictor -= diff;
+	else predictor += diff;
+	if (predictor > 32767) predictor = 32767;
+	else if (predictor < -32768) predictor = -32768;
+	st->predictor = (int16_t)predictor;
+
+	index = (int8_t)st->index + adpcm_index_change[code & 7];
+	if (index < 0) index = 0;
+	else if (index > ADPCM_NSTEPS - 1) index = ADPCM_NSTEPS - 1;
+	st->index = (uint8_t)index;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Encode a sample and return its 4-bit code								  */
+/*----------------------------------------------------------------------------*/
+uint8_t adpcm_encode(struct adpcmstate *st, int16_t sample) {
+	uint16_t step = adpcm_steps[st->index];
+	uint16_t diff;					// Magnitude of the difference
+	uint16_t vpdiff;				// The difference as the decoder sees it
+	uint8_t code = 0;
+
+	if (sample < st->predictor) {
+		code = 8;
+		diff = (uint16_t)(st->predictor - (int32_t)sample);
+	} else {
+		diff = (uint16_t)(sample - (int32_t)st->predictor);
+	}
+
+// Magnitude in quarter steps, rounded down
+	vpdiff = step >> 3;
+	if (diff >= step) {
+		code |= 4;
+		diff -= step;
+		vpdiff += step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		code |= 2;
+		diff -= step;
+		vpdiff += step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		code |= 1;
+		vpdiff += step;
+	}
+
+	adpcm_update(st, code, vpdiff);
+	return code;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Decode a 4-bit code and return the sample								  */
+/*----------------------------------------------------------------------------*/
+int16_t adpcm_decode(struct adpcmstate *st, uint8_t code) {
+	uint16_t step = adpcm_steps[st->index];
+	uint16_t vpdiff = step >> 3;
+
+	if (code & 4) vpdiff += step;
+	if (code & 2) vpdiff += step >> 1;
+	if (code & 1) vpdiff += step >> 2;
+
+	adpcm_update(st, code, vpdiff);
+	return st->predictor;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start a block with sample: write the block header (ADPCM_HEADER_SIZE		  */
+/* bytes) in given data buffer and make the sample the predictor			  */
+/*----------------------------------------------------------------------------*/
+void adpcm_header(uint8_t *data, struct adpcmstate *st, int16_t sample) {
+	st->predictor = sample;
+	data[0] = (uint8_t)(sample);
+	data[1] = (uint8_t)(sample >> 8);
+	data[2] = st->index;
+	data[3] = 0;					// Reserved
+}
+
+#endif
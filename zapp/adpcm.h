@@ -0,0 +1,24 @@
+/**
+ * IMA ADPCM codec library.
+ */
+
+#ifndef _ADPCMLIB_H
+#define _ADPCMLIB_H
+
+// Samples in a mono block of given size in bytes: the first sample as is in
+// the 4-byte block header, then two 4-bit codes per byte
+#define ADPCM_BLOCK_SAMPLES(size)	(((size) - 4) * 2 + 1)
+#define ADPCM_HEADER_SIZE	4
+
+#define ADPCM_NSTEPS		89			// Entries in the step size table
+
+struct adpcmstate {					// Encoder or decoder state
+	int16_t predictor;				// Last sample as the decoder sees it
+	uint8_t index;					// Step size index (0 .. ADPCM_NSTEPS - 1)
+};
+
+uint8_t adpcm_encode(struct adpcmstate *, int16_t sample);
+int16_t adpcm_decode(struct adpcmstate *, uint8_t code);
+void adpcm_header(uint8_t *data, struct adpcmstate *, int16_t sample);
+
+#endif
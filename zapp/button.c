@@ -0,0 +1,125 @@
+/**
+ * CTRL button state machine.
+ *
+ * A press is seen by the P1.1 edge interrupt (btn_press()), which starts a
+ * 128 Hz tick from the RTC prescaler.  From then on the button is sampled on
+ * each tick (btn_tick()) and the edge interrupt stays disabled, so contact
+ * bounce costs nothing: the press must still be down after BTN_DEBOUNCE ticks,
+ * then a release before BTN_HOLD_TICKS posts BTN_TAP and reaching it posts
+ * BTN_HOLD.  After the release has settled, the edge interrupt is armed
+ * again, and the RTC interrupt stops the tick unless LEDLIB still needs it.
+ *
+ * Neither interrupt waits for anything, so sampling goes on while the button
+ * is down.  The event is left in btn_event for the main loop to take.
+ */
+
+#ifndef _BTNLIB_C
+#define _BTNLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "msp430f5310_extra.h"
+#include "circuit.h"
+#include "button.h"
+
+// States
+#define BTN_IDLE		0			// Released, waiting for the edge interrupt
+#define BTN_DOWN		1			// Pressed (settling, then timing the hold)
+#define BTN_HELD		2			// Hold posted, waiting for the release
+#define BTN_UP			3			// Released, settling
+
+	volatile uint8_t btn_event;		// Pending event (BTN_NONE if none)
+
+	uint8_t btn_state = BTN_IDLE;	// State of the machine
+	uint16_t btn_ticks;				// Ticks since entering the state
+
+/*----------------------------------------------------------------------------*/
+/* Reset to the released state, with no event pending						  */
+/* (call after interrupt_config(), which arms the edge interrupt)			  */
+/*----------------------------------------------------------------------------*/
+void btn_reset(void) {
+	btn_state = BTN_IDLE;
+	btn_event = BTN_NONE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Handle the press edge (called by the Port 1 interrupt)					  */
+/*----------------------------------------------------------------------------*/
+void btn_press(void) {
+	clear_int_ctrl();
+	if (btn_state != BTN_IDLE) return;
+	ctrl_int_disable();				// Sample on the tick until released
+	btn_state = BTN_DOWN;
+	btn_ticks = 0;
+	rtc_tick_start();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Advance the state machine by a tick (called by the RTC interrupt)		  */
+/* Return the event posted, or BTN_NONE.									  */
+/*----------------------------------------------------------------------------*/
+uint8_t btn_tick(void) {
+	uint8_t ev = BTN_NONE;
+
+	btn_ticks++;
+	switch (btn_state) {
+	case BTN_DOWN:
+		if (btn_ticks < BTN_DEBOUNCE) break;
+		if (!ctrl_high()) {
+// Released: a tap, unless it did not outlast the bounce (noise)
+			if (btn_ticks > BTN_DEBOUNCE) ev = BTN_TAP;
+			btn_state = BTN_UP;
+			btn_ticks = 0;
+		} else if (btn_ticks >= BTN_HOLD_TICKS) {
+			ev = BTN_HOLD;
+			btn_state = BTN_HELD;
+		}
+		break;
+	case BTN_HELD:
+		if (!ctrl_high()) {
+			btn_state = BTN_UP;
+			btn_ticks = 0;
+		}
+		break;
+	case BTN_UP:
+		if (btn_ticks < BTN_DEBOUNCE) break;
+		if (ctrl_high()) {
+// Pressed again while settling: time the new press
+			btn_state = BTN_DOWN;
+			btn_ticks = 0;
+		} else {
+			btn_state = BTN_IDLE;
+			ctrl_int_enable();
+		}
+		break;
+	default:						// Released (tick kept for LEDLIB)
+		break;
+	}
+
+	if (ev != BTN_NONE) btn_event = ev;
+	return ev;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 once the button is released and settled (no tick needed)		  */
+/*----------------------------------------------------------------------------*/
+uint8_t btn_idle(void) {
+	return btn_state == BTN_IDLE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the pending event and clear it									  */
+/*----------------------------------------------------------------------------*/
+uint8_t btn_take(void) {
+	uint8_t ev;
+	__istate_t s = __get_interrupt_state();
+
+	__disable_interrupt();
+	ev = btn_event;
+	btn_event = BTN_NONE;
+	__set_interrupt_state(s);
+
+	return ev;
+}
+
+#endif
@@ -0,0 +1,28 @@
+/**
+ * CTRL button library.
+ */
+
+#ifndef _BTNLIB_H
+#define _BTNLIB_H
+
+// Button events, delivered to the main loop by btn_take()
+#define BTN_NONE		0
+#define BTN_TAP			1			// Pressed and released before the hold time
+#define BTN_HOLD		2			// Held down for the hold time
+
+// Timing in ticks of the RTC prescaler interrupt (ACLK / 256 = 128 Hz, see
+// rtc_tick_start())
+#define BTN_TICK_HZ		128
+#define BTN_DEBOUNCE	3			// Ticks for the contacts to settle (23 ms)
+#define BTN_HOLD_TICKS	(2 * BTN_TICK_HZ)	// Hold time (2 s)
+
+// Pending event, posted by the RTC interrupt
+extern volatile uint8_t btn_event;
+
+void btn_reset(void);
+void btn_press(void);
+uint8_t btn_tick(void);
+uint8_t btn_idle(void);
+uint8_t btn_take(void);
+
+#endif
@@ -0,0 +1,503 @@
+/**
+ * Sample capture: a single-producer, single-consumer ring of sector buffers
+ * between the sampling interrupt and the SD card writer.
+ *
+ * The head slot is filled one sample at a time by the sampling interrupt
+ * (capt_put()), or a sector at a time by DMA (capt_block_done() is then called
+ * by the DMA interrupt).  With CAPT_ENCODE, the 10-bit conversions are
+ * encoded into the head slot one at a time (capt_put_adc()), either by the
+ * sampling interrupt or by the DMA interrupt for each half of capt_raw: as
+ * mu-law codes looked up in capt_mulaw, or as IMA ADPCM.  Each ADPCM slot is
+ * a self-contained block, so an overrun loses one block and the next one
+ * decodes on its own.
+ *
+ * The producer hands the slot over by advancing the head index; the main
+ * loop writes the tail slot to the card and hands it back by advancing the
+ * tail index.  Each index is written by one side only and is a single
+ * byte, so neither side needs to disable interrupts.  When every other slot
+ * is still waiting to be written, the producer has no slot to move on to and
+ * the sector just filled is lost (it is overwritten).
+ *
+ * The main loop may borrow free slots as a data buffer while the ring is
+ * running (capt_lend()): the slots just behind the tail, which the producer
+ * would reach last, are taken out of the ring until capt_return(), and the
+ * producer counts an overrun rather than move into them.
+ *
+ * The sample rate and format are set at compile time (CAPT_RATE, CAPT_ADPCM,
+ * CAPT_MULAW and CAPT_PCM16) and described by capt_profile, from which the
+ * timer, the ADC10 and the clip headers are set up.
+ *
+ * Overruns are counted, along with the deepest backlog and the longest wait
+ * of a full sector, in capt_stats.  The statistics of a recording go into the
+ * clip files cut from it (a "zcap" chunk) and into the status record file.
+ */
+
+#ifndef _CAPTLIB_C
+#define _CAPTLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "sdfat.h"
+#include "wave.h"
+#include "adpcm.h"
+#include "mulaw.h"
+#include "capture.h"
+
+#if CAPT_NSLOTS < 2 || CAPT_NSLOTS > 128 || (CAPT_NSLOTS & (CAPT_NSLOTS - 1))
+#error "CAPT_NSLOTS must be a power of two from 2 to 128"
+#endif
+
+#define SLOT(i)			(&capt_buff[((i) & (CAPT_NSLOTS - 1)) * CAPT_SLOT_SIZE])
+
+// Set when the slots' levels are measured by the consumer (capt_level()), as
+// DMA fills the slots without the CPU; otherwise the producer measures each
+// sample as it stores it
+#define CAPT_LATE_LEVEL	(CAPT_DMA && !CAPT_ENCODE)
+
+/*----------------------------------------------------------------------------*/
+/* Global variables in the scope of this file								  */
+/*----------------------------------------------------------------------------*/
+	uint8_t capt_buff[CAPT_NSLOTS * CAPT_SLOT_SIZE];
+
+	volatile uint8_t capt_head;		// Slot being filled (producer)
+	volatile uint8_t capt_tail;		// Oldest full slot (consumer)
+	uint16_t capt_nbytes;			// Bytes in the head slot (producer only)
+	volatile uint8_t capt_nlent;	// Slots lent out behind the tail
+
+// Samples taken, modulo 2^16 (counted a sector at a time with CAPT_DMA)
+	volatile uint16_t capt_ticks;
+	uint16_t capt_stamp[CAPT_NSLOTS];	// Tick at which each slot filled
+
+	struct captstats capt_stats;
+
+// Level measurement (16-bit two's complement samples, see capt_measure())
+	int16_t capt_dc;				// Mean of the last slot measured
+	int32_t capt_sum;				// Sum of the samples measured since
+	uint32_t capt_dev;				// Sum of their deviations from capt_dc
+	uint16_t capt_peak;				// Largest deviation
+	struct captlevel capt_levels[CAPT_NSLOTS];	// Level of each full slot
+#if CAPT_LATE_LEVEL
+	uint8_t capt_measured;			// Slot index + 1 of the last slot measured
+#endif
+
+// Capture profile, from the compile-time settings (see capture.h)
+	const struct captprofile capt_profile = {
+		CAPT_RATE,					// nsamplerate
+		CAPT_PERIOD,				// period
+		CAPT_SLOT_SAMPLES,			// nslotsamples
+#if CAPT_ADPCM
+		WAVE_FORMAT_IMA_ADPCM,		// format
+		CAPT_SLOT_SIZE,				// nblockalign: one slot per block
+		4,							// bits
+#elif CAPT_MULAW
+		WAVE_FORMAT_MULAW,
+		1,
+		8,
+#elif CAPT_PCM16
+		WAVE_FORMAT_PCM,
+		2,
+		16,
+#else
+		WAVE_FORMAT_PCM,
+		1,
+		8,
+#endif
+		CAPT_ENCODE || CAPT_PCM16 ? 10 : 8	// adcbits
+	};
+
+#if CAPT_ADPCM
+	struct adpcmstate capt_adpcm;	// Encoder state
+	uint8_t capt_odd;				// Set when a code waits for its high nibble
+#endif
+#if CAPT_MULAW
+// Mu-law code of each 10-bit conversion, worked out by the compiler
+	const uint8_t capt_mulaw[1024] = { MULAW_ADC_TABLE };
+#endif
+#if CAPT_ENCODE && CAPT_DMA
+	uint16_t capt_raw[2 * CAPT_RAW_SIZE];	// Conversions, filled by DMA
+	uint8_t capt_raw_half;			// Half being filled (0 or 1)
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Empty the ring (call with the sampling interrupt stopped)				  */
+/*----------------------------------------------------------------------------*/
+void capt_reset(void) {
+	capt_head = 0;
+	capt_tail = 0;
+	capt_nbytes = 0;
+	capt_nlent = 0;
+	capt_ticks = 0;
+	capt_stats.nsects = 0;
+	capt_stats.ndropped = 0;
+	capt_stats.maxlatency = 0;
+	capt_stats.maxbacklog = 0;
+	capt_dc = 0;
+	capt_sum = 0;
+	capt_dev = 0;
+	capt_peak = 0;
+#if CAPT_LATE_LEVEL
+	capt_measured = 0;
+#endif
+#if CAPT_ADPCM
+	capt_adpcm.index = 0;
+	capt_odd = 0;
+#endif
+#if CAPT_ENCODE && CAPT_DMA
+	capt_raw_half = 1;				// capt_raw_swap() starts with the first
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* Add a sample, scaled to 16-bit two's complement, to the level of the slot  */
+/* being measured															  */
+/*----------------------------------------------------------------------------*/
+void capt_measure(int16_t sample) {
+	int32_t dev = (int32_t)sample - capt_dc;
+
+	if (dev < 0) dev = -dev;
+	capt_sum += sample;
+	capt_dev += (uint16_t)dev;
+	if ((uint16_t)dev > capt_peak) capt_peak = (uint16_t)dev;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set the level of slot i from the samples measured, which become the mean	  */
+/* the next slot's deviations are taken from								  */
+/*----------------------------------------------------------------------------*/
+void capt_measure_slot(uint8_t i) {
+	struct captlevel *lvl = &capt_levels[i & (CAPT_NSLOTS - 1)];
+
+	lvl->level = (uint16_t)DIV32(capt_dev, CAPT_SLOT_SAMPLES);
+	lvl->peak = capt_peak;
+	capt_dc = (int16_t)SDIV32(capt_sum, CAPT_SLOT_SAMPLES);
+	capt_sum = 0;
+	capt_dev = 0;
+	capt_peak = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Hand the full head slot over to the writer (producer side)				  */
+/*----------------------------------------------------------------------------*/
+void capt_handover(void) {
+	uint8_t head = capt_head;
+	uint8_t backlog;
+
+	capt_stats.nsects++;
+#if !CAPT_LATE_LEVEL
+	capt_measure_slot(head);
+#endif
+
+// Move on to the next slot unless it is the oldest one still to be written
+// or a lent one
+	backlog = head - capt_tail + 1;
+	if (backlog < CAPT_NSLOTS - capt_nlent) {
+		capt_stamp[head & (CAPT_NSLOTS - 1)] = capt_ticks;
+		capt_head = head + 1;
+		if (backlog > capt_stats.maxbacklog) capt_stats.maxbacklog = backlog;
+	} else {
+		capt_stats.ndropped++;		// Overrun: the sector is overwritten
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Store a sample in the head slot, handing the slot over to the writer when */
+/* it is full (called by the sampling interrupt)							  */
+/* Return 1 if the slot was handed over, 0 otherwise.						  */
+/*----------------------------------------------------------------------------*/
+uint8_t capt_put(uint8_t sample) {
+#if !CAPT_LATE_LEVEL
+	capt_measure((int16_t)((uint16_t)(sample << 8) ^ 0x8000));
+#endif
+	capt_ticks++;
+	SLOT(capt_head)[capt_nbytes] = sample;
+	if (++capt_nbytes < CAPT_SLOT_SIZE) return 0;
+
+	capt_nbytes = 0;
+	capt_handover();
+	return 1;
+}
+
+#if CAPT_PCM16
+/*----------------------------------------------------------------------------*/
+/* Store a 16-bit sample (low byte first) in the head slot, handing the slot  */
+/* over to the writer when it is full (called by the sampling interrupt)	  */
+/* Return 1 if the slot was handed over, 0 otherwise.						  */
+/*----------------------------------------------------------------------------*/
+uint8_t capt_put16(uint16_t sample) {
+	uint8_t *slot = SLOT(capt_head);
+
+#if !CAPT_LATE_LEVEL
+	capt_measure((int16_t)sample);
+#endif
+	capt_ticks++;
+	slot[capt_nbytes] = (uint8_t)sample;
+	slot[capt_nbytes + 1] = (uint8_t)(sample >> 8);
+	capt_nbytes += 2;
+	if (capt_nbytes < CAPT_SLOT_SIZE) return 0;
+
+	capt_nbytes = 0;
+	capt_handover();
+	return 1;
+}
+#endif
+
+#if CAPT_ENCODE
+/*----------------------------------------------------------------------------*/
+/* Encode a 10-bit conversion into the head slot, handing the slot over to	  */
+/* the writer when it is full (called by the sampling or DMA interrupt)		  */
+/* Return 1 if the slot was handed over, 0 otherwise.						  */
+/*----------------------------------------------------------------------------*/
+uint8_t capt_put_adc(uint16_t value) {
+	uint8_t *slot = SLOT(capt_head);
+	int16_t sample;
+#if CAPT_ADPCM
+	uint8_t code;
+#endif
+
+	capt_ticks++;
+// 10-bit offset binary to 16-bit two's complement
+	sample = (int16_t)((uint16_t)(value << 6) ^ 0x8000);
+	capt_measure(sample);
+
+#if CAPT_MULAW
+	slot[capt_nbytes] = capt_mulaw[value & 0x3FF];
+#else
+// Each block starts with a sample as is
+	if (capt_nbytes == 0) {
+		adpcm_header(slot, &capt_adpcm, sample);
+		capt_nbytes = ADPCM_HEADER_SIZE;
+		return 0;
+	}
+
+// Two codes per byte, the first one in the low nibble
+	code = adpcm_encode(&capt_adpcm, sample);
+	if (!capt_odd) {
+		slot[capt_nbytes] = code;
+		capt_odd = 1;
+		return 0;
+	}
+	slot[capt_nbytes] |= code << 4;
+	capt_odd = 0;
+#endif
+	if (++capt_nbytes < CAPT_SLOT_SIZE) return 0;
+
+	capt_nbytes = 0;
+	capt_handover();
+	return 1;
+}
+
+#if CAPT_DMA
+/*----------------------------------------------------------------------------*/
+/* Switch DMA to the other half of capt_raw and return it (called by the DMA  */
+/* interrupt at the end of each transfer, then capt_raw_encode())			  */
+/*----------------------------------------------------------------------------*/
+uint16_t *capt_raw_swap(void) {
+	capt_raw_half ^= 1;
+	return &capt_raw[capt_raw_half * CAPT_RAW_SIZE];
+}
+
+/*----------------------------------------------------------------------------*/
+/* Encode the half of capt_raw that DMA has just filled						  */
+/* Return 1 if a slot was handed over, 0 otherwise.							  */
+/*----------------------------------------------------------------------------*/
+uint8_t capt_raw_encode(void) {
+	uint16_t *raw = &capt_raw[(capt_raw_half ^ 1) * CAPT_RAW_SIZE];
+	uint8_t done = 0;
+	uint8_t i;
+
+	for (i = 0; i < CAPT_RAW_SIZE; i++) {
+		done |= capt_put_adc(raw[i]);
+	}
+	return done;
+}
+#endif
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Return the head slot, where the samples go								  */
+/*----------------------------------------------------------------------------*/
+uint8_t *capt_fill_slot(void) {
+	return SLOT(capt_head);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Hand the head slot, filled by DMA, over to the writer and return the slot */
+/* to fill next (called by the DMA interrupt)								  */
+/*----------------------------------------------------------------------------*/
+uint8_t *capt_block_done(void) {
+	capt_ticks += CAPT_SLOT_SAMPLES;
+	capt_handover();
+	return SLOT(capt_head);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the number of full slots waiting to be written					  */
+/*----------------------------------------------------------------------------*/
+uint8_t capt_backlog(void) {
+	return capt_head - capt_tail;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the oldest full slot, or 0 if there is none						  */
+/* The slot stays valid until capt_pop() is called.							  */
+/*----------------------------------------------------------------------------*/
+uint8_t *capt_peek(void) {
+	uint8_t tail = capt_tail;
+
+	if (capt_head == tail) return 0;
+	return SLOT(tail);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the level of the oldest full slot (call once capt_peek() returns	  */
+/* it), in 16-bit units: its samples' mean and largest deviation from the	  */
+/* previous slot's mean														  */
+/* With DMA filling 8 or 16-bit PCM slots, the level is measured here, on the*/
+/* first call for each slot.												  */
+/*----------------------------------------------------------------------------*/
+const struct captlevel *capt_level(void) {
+	uint8_t tail = capt_tail;
+#if CAPT_LATE_LEVEL
+	uint8_t *slot = SLOT(tail);
+	uint16_t i;
+
+	if (capt_measured != (uint8_t)(tail + 1)) {
+		for (i = 0; i < CAPT_SLOT_SAMPLES; i++) {
+#if CAPT_PCM16
+			capt_measure((int16_t)(slot[2 * i] | slot[2 * i + 1] << 8));
+#else
+			capt_measure((int16_t)((uint16_t)(slot[i] << 8) ^ 0x8000));
+#endif
+		}
+		capt_measure_slot(tail);
+		capt_measured = tail + 1;
+	}
+#endif
+	return &capt_levels[tail & (CAPT_NSLOTS - 1)];
+}
+
+/*----------------------------------------------------------------------------*/
+/* Fill a block with silence in the capture format: samples at mid-scale	  */
+/* (with CAPT_ADPCM, a block that starts there and holds still)				  */
+/*----------------------------------------------------------------------------*/
+void capt_silence(uint8_t *block) {
+	uint16_t i;
+
+	for (i = 0; i < CAPT_SLOT_SIZE; i++) {
+#if CAPT_MULAW
+		block[i] = 0xFF;			// Code of 0
+#elif CAPT_ADPCM || CAPT_PCM16
+		block[i] = 0;				// Predictor 0, step index 0, codes 0
+#else
+		block[i] = 0x80;
+#endif
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Hand the oldest full slot back to the producer once it is written		  */
+/*----------------------------------------------------------------------------*/
+void capt_pop(void) {
+	uint8_t tail = capt_tail;
+	uint16_t latency = capt_ticks - capt_stamp[tail & (CAPT_NSLOTS - 1)];
+
+	if (latency > capt_stats.maxlatency) capt_stats.maxlatency = latency;
+	capt_tail = tail + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Lend the nslots free slots behind the tail (adjacent in capt_buff) to the  */
+/* consumer and return the first one, or 0 if they are not adjacent or the	  */
+/* producer is already in one of them										  */
+/* The consumer may not pop slots until capt_return().						  */
+/*----------------------------------------------------------------------------*/
+uint8_t *capt_lend(uint8_t nslots) {
+	uint8_t tail = capt_tail;
+	uint8_t *slot = 0;
+	__istate_t s;
+
+	if (((tail - nslots) & (CAPT_NSLOTS - 1)) >
+		((tail - 1) & (CAPT_NSLOTS - 1))) return 0;
+
+	s = __get_interrupt_state();
+	__disable_interrupt();
+	if ((uint8_t)(capt_head - tail) + 1 + nslots <= CAPT_NSLOTS) {
+		capt_nlent = nslots;
+		slot = SLOT(tail - nslots);
+	}
+	__set_interrupt_state(s);
+
+	return slot;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Give the lent slots back to the producer									  */
+/*----------------------------------------------------------------------------*/
+void capt_return(void) {
+	capt_nlent = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the capture statistics chunk in given data buffer and return its	  */
+/* size (CAPT_CHUNK_SIZE)													  */
+/*----------------------------------------------------------------------------*/
+uint16_t capt_stats_chunk(uint8_t *data) {
+	struct captstats st;
+	uint16_t i;
+	__istate_t s = __get_interrupt_state();
+
+// Copy the statistics at once (sampling may be running)
+	__disable_interrupt();
+	st = capt_stats;
+	__set_interrupt_state(s);
+
+	for (i = 0; i < 4; i++) data[i] = CAPT_CHUNK_ID[i];
+	data[4] = CAPT_CHUNK_SIZE - 8;	// Chunk size
+	data[5] = 0;
+	data[6] = 0;
+	data[7] = 0;
+	data[8] = (uint8_t)(st.nsects);
+	data[9] = (uint8_t)(st.nsects >> 8);
+	data[10] = (uint8_t)(st.nsects >> 16);
+	data[11] = (uint8_t)(st.nsects >> 24);
+	data[12] = (uint8_t)(st.ndropped);
+	data[13] = (uint8_t)(st.ndropped >> 8);
+	data[14] = (uint8_t)(st.ndropped >> 16);
+	data[15] = (uint8_t)(st.ndropped >> 24);
+	data[16] = (uint8_t)(st.maxlatency);
+	data[17] = (uint8_t)(st.maxlatency >> 8);
+	data[18] = st.maxbacklog;
+	data[19] = CAPT_NSLOTS;
+
+	return CAPT_CHUNK_SIZE;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Locate the status record file, creating it if it does not exist			  */
+/* The data buffer must hold one block.										  */
+/* Return the offset of the status record, 0 on error.						  */
+/*----------------------------------------------------------------------------*/
+uint32_t capt_open_status(uint8_t *data, struct fatstruct *info) {
+	uint32_t dteoffset;
+	uint16_t clust;
+
+	clust = open_file(data, info, (uint8_t *)CAPT_STATUS_NAME,
+		CAPT_STATUS_ATTR, 1, &dteoffset);
+	if (clust == 0) return 0;
+
+	return get_cluster_offset(clust, info);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the capture statistics to the status record at offset				  */
+/* The data buffer must hold one block.										  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t capt_write_status(uint8_t *data, uint32_t offset) {
+	uint16_t n;
+
+	n = capt_stats_chunk(data);
+	return write_block(data, offset, n);
+}
+
+#endif
@@ -0,0 +1,193 @@
+/**
+ * Sample capture library.
+ */
+
+#ifndef _CAPTLIB_H
+#define _CAPTLIB_H
+
+// Number of sector slots in the ring between the sampling interrupt and the
+// SD card writer (a power of two, at most 128).  Each slot takes 512 bytes of
+// the 6 KB of RAM, and each gives a sector's worth of slack against card busy
+// periods: 127 ms of ADPCM at 8 kHz, 64 ms of 8-bit samples, 16 ms of 16-bit
+// samples at 16 kHz.  With 8 slots, up to 7 full sectors (890 ms of ADPCM at
+// 8 kHz) can wait to be written.
+#ifndef CAPT_NSLOTS
+#define CAPT_NSLOTS		8
+#endif
+
+#define CAPT_SLOT_SIZE	512			// Bytes per slot (one block)
+
+// Set to 0 to store 8-bit PCM samples.  By default, the ADC10 converts with
+// 10-bit resolution and each slot is filled with one IMA ADPCM block (WAVE
+// format 0x11, 4 bits per sample), so a sector holds twice the audio: the
+// card is written half as often and the circular buffer holds twice the
+// history.
+#ifndef CAPT_ADPCM
+#define CAPT_ADPCM		1
+#endif
+
+// Set to 1, with CAPT_ADPCM set to 0, to store 8-bit G.711 mu-law samples
+// (WAVE format 7) companded from 10-bit conversions: as many bytes as 8-bit
+// PCM, with steps 4 times finer for quiet sound (see mulaw.h).
+#ifndef CAPT_MULAW
+#define CAPT_MULAW		0
+#endif
+
+// Set to 1, with CAPT_ADPCM set to 0, to store 16-bit PCM samples (WAVE
+// format 1, signed): the ADC10 converts with 10-bit resolution and returns
+// its results left-aligned in two's complement (ADC10DF), which is how the
+// samples are stored, so they go into the slot as they are.
+#ifndef CAPT_PCM16
+#define CAPT_PCM16		0
+#endif
+
+#if CAPT_ADPCM + CAPT_MULAW + CAPT_PCM16 > 1
+#error "Only one of CAPT_ADPCM, CAPT_MULAW and CAPT_PCM16 may be set"
+#endif
+
+// Sample rate (Hz), from 4 to 16 kHz (8000, 11025 and 16000 are the usual
+// ones).  Timer0_A divides its clock by the nearest whole number, so the
+// actual rate may be slightly off: 11029 Hz for 11025.
+#ifndef CAPT_RATE
+#define CAPT_RATE		8000
+#endif
+
+#if CAPT_RATE < 4000 || CAPT_RATE > 16000
+#error "CAPT_RATE must be from 4000 to 16000"
+#endif
+
+#define CAPT_CLOCK_HZ	12000000UL	// Timer0_A clock (SMCLK, see clock_config())
+// Timer0_A ticks per sample
+#define CAPT_PERIOD		((CAPT_CLOCK_HZ + CAPT_RATE / 2) / CAPT_RATE)
+
+// Set when samples are 10-bit conversions that the CPU encodes into the head
+// slot (capt_put_adc())
+#define CAPT_ENCODE		(CAPT_ADPCM || CAPT_MULAW)
+
+// Samples per slot: the head slot is handed over to the writer when it holds
+// as many
+#if CAPT_ADPCM
+#define CAPT_SLOT_SAMPLES	ADPCM_BLOCK_SAMPLES(CAPT_SLOT_SIZE)	// 1017
+#elif CAPT_PCM16
+#define CAPT_SLOT_SAMPLES	(CAPT_SLOT_SIZE / 2)
+#else
+#define CAPT_SLOT_SAMPLES	CAPT_SLOT_SIZE
+#endif
+
+// Longest card busy period (ms) the ring rides out while a clip is saved in
+// the background: a garbage collection stall of a typical card
+#ifndef CAPT_STALL_MS
+#define CAPT_STALL_MS	100
+#endif
+
+// Audio held by a slot (us)
+#define CAPT_SLOT_US	(CAPT_SLOT_SAMPLES * 1000000UL / CAPT_RATE)
+
+// Slots lent as data buffer to a clip's copy (see capt_lend()): two, so each
+// copy step moves two blocks, unless the slots left would then hold less than
+// CAPT_STALL_MS of audio.  16-bit samples at 16 kHz only lend one (7 slots
+// hold 112 ms, 6 only 96 ms).
+#if (CAPT_NSLOTS - 2) * CAPT_SLOT_US >= CAPT_STALL_MS * 1000UL
+#define CAPT_LEND		2
+#elif (CAPT_NSLOTS - 1) * CAPT_SLOT_US >= CAPT_STALL_MS * 1000UL
+#define CAPT_LEND		1
+#else
+#error "The ring cannot hold CAPT_STALL_MS of audio with a slot lent"
+#endif
+
+#if CAPT_ENCODE
+// Conversions moved by each DMA transfer (with CAPT_DMA).  They go to one
+// half of capt_raw while the other half is being encoded.
+#define CAPT_RAW_SIZE	32
+#endif
+
+// Set to 0 to take each sample in the Timer0_A CCR0 interrupt (adc_read()
+// and capt_put(), capt_put16() or capt_put_adc()).  By default, Timer0_A
+// triggers the ADC10 conversions in hardware and DMA channel 2 stores the
+// results in the head slot (whole words with CAPT_PCM16), so the CPU is only
+// interrupted once per sector (capt_block_done()).
+// With CAPT_ENCODE, DMA stores CAPT_RAW_SIZE conversions at a time and the DMA
+// interrupt encodes them (capt_raw_swap() and capt_raw_encode()).
+#ifndef CAPT_DMA
+#define CAPT_DMA		1
+#endif
+
+// Capture statistics chunk, in clip files and in the status record: ID, then
+// the fields of struct captstats (little-endian) and the number of slots
+#define CAPT_CHUNK_ID	"zcap"
+#define CAPT_CHUNK_SIZE	20			// Bytes, with the chunk's ID and size
+
+// Status record file (8.3 format without the dot), one cluster holding the
+// statistics chunk of the last recording
+#define CAPT_STATUS_NAME	"ZAPPSTATBIN"
+#define CAPT_STATUS_ATTR	0x06	// Hidden, system
+
+struct captlevel {					// Level of a slot (see capt_level())
+	uint16_t level;					// Mean deviation (16-bit units)
+	uint16_t peak;					// Largest deviation (16-bit units)
+};
+
+struct captprofile {				// Capture profile (see capt_profile)
+	uint32_t nsamplerate;			// Sample rate (Hz)
+	uint16_t period;				// Timer0_A ticks per sample
+	uint16_t nslotsamples;			// Samples per slot
+	uint16_t format;				// WAVE format of the samples
+	uint16_t nblockalign;			// Bytes per WAVE block
+	uint8_t bits;					// Bits per stored sample (4, 8 or 16)
+	uint8_t adcbits;				// ADC10 resolution (8 or 10 bits)
+};
+
+struct captstats {					// Capture statistics since capt_reset()
+	uint32_t nsects;				// Sectors filled
+	uint32_t ndropped;				// Sectors lost to overruns (ring full)
+// Worst time from a sector filling to it being sent to the card, in sample
+// periods (Timer0_A ticks; whole sectors or DMA transfers of them with
+// CAPT_DMA)
+	uint16_t maxlatency;
+	uint8_t maxbacklog;				// Most full slots waiting at once
+};
+
+// Sector ring storage.  While nothing is being captured, it serves as scratch
+// buffer (one or more adjacent blocks) for the storage code.
+extern uint8_t capt_buff[CAPT_NSLOTS * CAPT_SLOT_SIZE];
+
+// Ring indices, counting slots modulo 256: slots tail .. head - 1 are full
+// and waiting to be written, slot head is being filled.  head is only written
+// by the producer (the sampling interrupt), tail only by the consumer.
+extern volatile uint8_t capt_head;
+extern volatile uint8_t capt_tail;
+
+// Statistics: nsects, ndropped and maxbacklog are kept by the producer, so
+// read them with sampling stopped (or with interrupts disabled, as
+// capt_stats_chunk() does); maxlatency is kept by the consumer.
+extern struct captstats capt_stats;
+
+// Capture profile, as set up by CAPT_RATE and the sample format: the timer,
+// the ADC10, the ring and the clip headers are all set up from it
+extern const struct captprofile capt_profile;
+
+#if CAPT_MULAW
+// mu-law code of each 10-bit conversion (see mulaw.h)
+extern const uint8_t capt_mulaw[1024];
+#endif
+
+void capt_reset(void);
+uint8_t capt_put(uint8_t sample);
+uint8_t capt_put16(uint16_t sample);
+uint8_t capt_put_adc(uint16_t value);
+uint16_t *capt_raw_swap(void);
+uint8_t capt_raw_encode(void);
+uint8_t *capt_fill_slot(void);
+uint8_t *capt_block_done(void);
+uint8_t capt_backlog(void);
+uint8_t *capt_peek(void);
+const struct captlevel *capt_level(void);
+void capt_silence(uint8_t *block);
+void capt_pop(void);
+uint8_t *capt_lend(uint8_t nslots);
+void capt_return(void);
+uint16_t capt_stats_chunk(uint8_t *data);
+uint32_t capt_open_status(uint8_t *data, struct fatstruct *);
+uint8_t capt_write_status(uint8_t *data, uint32_t offset);
+
+#endif
@@ -0,0 +1,678 @@
+/**
+ * Clip storage: recording to the circular buffer and saving its most recent
+ * part as a new WAVE file.
+ *
+ * A clip is the clip length of recording that precedes the bookmark (the
+ * offset at which recording stopped), taking the wrap into account.
+ *
+ * By default the circular buffer is a raw region of the SD card outside of
+ * any file, and a clip is copied out of it.  With CLIP_RELINK set, the
+ * circular buffer is the cluster chain of a hidden file instead, and a clip's
+ * clusters are moved from that chain into the new file's chain, with fresh
+ * clusters taking their place in the circular buffer.  Only the FAT, the
+ * directory table and the WAVE header are written.
+ *
+ * A clip file starts with a header block (a header cluster in relink mode)
+ * whose chunks are padded with a JUNK chunk, so the audio is block aligned:
+ * with CAPT_ADPCM, each block of it is one IMA ADPCM block, described by the
+ * format chunk.  Compressed audio (CAPT_ENCODE) is counted by a fact chunk.
+ *
+ * The recorder walks the circular buffer in runs of consecutive blocks: the
+ * whole buffer in copy mode, one cluster in relink mode.  circ_next() returns
+ * 0 at the end of a run, and circ_next_run() (called with no streaming
+ * session open, since it may read the FAT) locates the next one.
+ *
+ * With CIRC_GATE, the recorder leaves silent sectors out: it closes its
+ * streaming session and moves on to the next block without writing, and the
+ * block is marked silent in the silence map (circ_mark()) instead.  Positions
+ * in the circular buffer still follow time, so a clip covers the same span,
+ * and the copy writes silence for the blocks marked (a run of them costs no
+ * reading).
+ *
+ * Recording goes on while a clip is saved.  clip_begin() starts the save at
+ * the bookmark, then the recorder calls clip_step() whenever it has nothing
+ * to write, with its streaming session closed, until clip_busy() returns 0.
+ * Each step copies a few blocks, so sectors captured meanwhile wait little.
+ * The clip's blocks still to be copied are kept from the recorder: sessions
+ * do not pre-erase them (circ->keep, and circ->pend for a clip waiting to be
+ * begun, see circ_pend()) and clip_overrun() tells the recorder when its next
+ * block would be one of them: the clip is then given up (clip_abort()) and
+ * recording goes on.  In relink mode, clip_begin() saves the whole clip (no
+ * audio is copied) and recording continues at the start of the circular
+ * buffer.
+ */
+
+#ifndef _CLIPLIB_C
+#define _CLIPLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "sdfat.h"
+#include "wave.h"
+#include "msp430f5310_extra.h"
+#include "clip.h"
+#include "adpcm.h"
+#include "capture.h"
+
+void write_clip_header(	uint8_t *data, struct ck *dat,
+						uint32_t total_bytes, uint32_t header_bytes);
+
+/*----------------------------------------------------------------------------*/
+/* Locate the circular buffer (call once at mount)							  */
+/* In relink mode, the circular buffer file is created if it does not exist.  */
+/* The data buffer must hold one block.										  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t circ_open(uint8_t *data, struct fatstruct *info,
+					struct circstruct *circ) {
+// Size of file clip: CLIP_NCLUSTS clusters (a multiple of 512, see clip.h)
+	circ->cliplength = CLIP_NCLUSTS * info->nbytesinclust;
+	circ->keep = 0;
+
+#if CLIP_RELINK
+	circ->begin = 0;
+	circ->end = 0;
+
+// Find or create the circular buffer file as one contiguous extent
+	circ->first = open_file(data, info, (uint8_t *)CIRC_FILE_NAME,
+		CIRC_FILE_ATTR, CIRC_BUFF_CLUST_END - CIRC_BUFF_CLUST_BEGIN,
+		&circ->dteoffset);
+	if (circ->first == 0) return 1;
+#else
+	circ->begin	= CIRC_BUFF_CLUST_BEGIN * info->nbytesinclust;
+	circ->end	= CIRC_BUFF_CLUST_END * info->nbytesinclust;
+	circ->pend = 0;
+#endif
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the offset of the first block of the circular buffer, where		  */
+/* recording starts															  */
+/*----------------------------------------------------------------------------*/
+uint32_t circ_start(struct fatstruct *info, struct circstruct *circ) {
+#if CIRC_GATE
+	uint8_t i;
+
+	for (i = 0; i < CIRC_NMAP / 8; i++) {
+		circ->silent[i] = 0;		// Blocks not known to be silent
+	}
+#endif
+#if CLIP_RELINK
+	circ->hist[0] = circ->first;
+	circ->nhist = 1;
+	circ->clustoffset = get_cluster_offset(circ->first, info);
+	return circ->clustoffset;
+#else
+	circ->pend = 0;
+	return circ->begin;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the offset of the block following offset in the current run, or 0	  */
+/* at the end of the run													  */
+/*----------------------------------------------------------------------------*/
+uint32_t circ_next(struct fatstruct *info, struct circstruct *circ,
+					uint32_t offset) {
+	offset += 512;
+#if CLIP_RELINK
+	if (offset - circ->clustoffset == info->nbytesinclust) return 0;
+#else
+	if (offset == circ->end) return 0;
+#endif
+	return offset;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Move on to the next run of the circular buffer (wrapping around at the	  */
+/* end) and return the offset of its first block.  The FAT may be read, so	  */
+/* no streaming session may be open.										  */
+/* Return 0 on error.														  */
+/*----------------------------------------------------------------------------*/
+uint32_t circ_next_run(struct fatstruct *info, struct circstruct *circ) {
+#if CLIP_RELINK
+	uint16_t clust;
+	uint8_t i;
+
+// Follow the chain from the cluster being recorded
+	if ((clust = next_cluster(info, circ->hist[circ->nhist - 1])) == 0)
+		return 0;
+	if (clust >= FAT_EOC) clust = circ->first;
+
+/* Remember the cluster, dropping the oldest one if hist is full */
+	if (circ->nhist == CIRC_NHIST) {
+		for (i = 1; i < CIRC_NHIST; i++) circ->hist[i-1] = circ->hist[i];
+		circ->nhist--;
+	}
+	circ->hist[circ->nhist++] = clust;
+
+	circ->clustoffset = get_cluster_offset(clust, info);
+	return circ->clustoffset;
+#else
+	return circ->begin;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the pre-erase hint for a streaming session from offset to the end	  */
+/* of the current run, in blocks											  */
+/*----------------------------------------------------------------------------*/
+uint32_t circ_run_blocks(struct fatstruct *info, struct circstruct *circ,
+							uint32_t offset) {
+#if CLIP_RELINK
+	return (circ->clustoffset + info->nbytesinclust - offset) / 512;
+#else
+	uint32_t n = (circ->end - offset) / 512;
+
+/* Blocks left over after an interrupted session may be erased by the card, so
+the hint stops a clip length short of a wrap around the circular buffer. That
+keeps the tail needed by a clip taken shortly after a wrap intact. */
+	if (n > (circ->end - circ->begin - circ->cliplength) / 512) {
+		n = (circ->end - circ->begin - circ->cliplength) / 512;
+	}
+// Nor may it reach the clip being saved, or the one waiting for it
+	if (circ->keep > offset && n > (circ->keep - offset) / 512) {
+		n = (circ->keep - offset) / 512;
+	}
+	if (circ->pend > offset && n > (circ->pend - offset) / 512) {
+		n = (circ->pend - offset) / 512;
+	}
+	return n;
+#endif
+}
+
+#if CIRC_GATE
+/*----------------------------------------------------------------------------*/
+/* Record in the silence map whether the block at offset is silent (left out  */
+/* of the circular buffer) or written										  */
+/*----------------------------------------------------------------------------*/
+void circ_mark(struct circstruct *circ, uint32_t offset, uint8_t silent) {
+	uint16_t i = (uint16_t)((offset - circ->begin) / 512) & (CIRC_NMAP - 1);
+
+	if (silent) {
+		circ->silent[i / 8] |= 1 << (i % 8);
+	} else {
+		circ->silent[i / 8] &= ~(1 << (i % 8));
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 if the block at offset (one of the last CIRC_NMAP recorded) was	  */
+/* silent and left out, 0 if it was written									  */
+/*----------------------------------------------------------------------------*/
+uint8_t circ_silent(struct circstruct *circ, uint32_t offset) {
+	uint16_t i = (uint16_t)((offset - circ->begin) / 512) & (CIRC_NMAP - 1);
+
+	return (circ->silent[i / 8] >> (i % 8)) & 1;
+}
+#endif
+
+#if !CLIP_RELINK
+/*----------------------------------------------------------------------------*/
+/* Keep the clip preceding bookmark, which waits for the one being saved, from */
+/* pre-erasure until it is begun (see clip_begin())							  */
+/*----------------------------------------------------------------------------*/
+void circ_pend(struct circstruct *circ, uint32_t bookmark) {
+	circ->pend = bookmark - circ->cliplength;
+	if (circ->pend < circ->begin) {
+		circ->pend = circ->end - (circ->begin - circ->pend);
+	}
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Write the first block of a clip file of total_bytes, whose audio starts at*/
+/* header_bytes (a whole number of blocks), in given data buffer: RIFF,		  */
+/* format, fact (CAPT_ENCODE only) and capture statistics chunks, then a	  */
+/* JUNK chunk up to the data chunk's header, which takes the last 8 bytes	  */
+/* before the audio.  The data chunk's info is set in dat; its header is	  */
+/* written at the end of the block if header_bytes is 512.					  */
+/*----------------------------------------------------------------------------*/
+void write_clip_header(	uint8_t *data, struct ck *dat,
+						uint32_t total_bytes, uint32_t header_bytes) {
+	struct ckriff	riff;			// RIFF chunk
+	struct ckfmt	fmt;			// Format chunk
+#if CAPT_ENCODE
+	struct ckfact	fact;			// Fact chunk
+#endif
+	struct ck		junk;			// JUNK chunk (info only)
+	uint16_t		i;
+
+	riff.info.ckid[0] = 'R';		// Chunk ID: "RIFF"
+	riff.info.ckid[1] = 'I';
+	riff.info.ckid[2] = 'F';
+	riff.info.ckid[3] = 'F';
+// Chunk size
+	riff.info.cksize = total_bytes - sizeof(riff.info);
+	riff.format[0] = 'W';			// RIFF format: "WAVE"
+	riff.format[1] = 'A';
+	riff.format[2] = 'V';
+	riff.format[3] = 'E';
+	fmt.info.ckid[0] = 'f';			// Chunk ID: "fmt"
+	fmt.info.ckid[1] = 'm';
+	fmt.info.ckid[2] = 't';
+	fmt.info.ckid[3] = ' ';
+	fmt.nchannels = 1;				// Channels: 1 (Mono)
+// Sample rate and format: the capture profile's
+	fmt.nsamplerate = capt_profile.nsamplerate;
+	fmt.format = capt_profile.format;
+	fmt.bits = capt_profile.bits;	// Bits per sample
+	fmt.nblockalign = capt_profile.nblockalign;	// Block alignment
+// Average data-transfer rate: a slot's bytes per slot's samples
+	fmt.navgrate = capt_profile.nsamplerate * CAPT_SLOT_SIZE /
+		capt_profile.nslotsamples;
+#if CAPT_ADPCM
+	fmt.info.cksize = 20;			// Chunk size: 20 (with the extension)
+	fmt.cbsize = 2;
+	fmt.nsamplesperblock = CAPT_SLOT_SAMPLES;
+#elif CAPT_MULAW
+	fmt.info.cksize = 18;			// Chunk size: 18 (with the extension)
+	fmt.cbsize = 0;					// No extension fields
+#else
+	fmt.info.cksize = 16;			// Chunk size: 16
+#endif
+	dat->ckid[0] = 'd';				// Chunk ID: "data"
+	dat->ckid[1] = 'a';
+	dat->ckid[2] = 't';
+	dat->ckid[3] = 'a';
+	dat->cksize = total_bytes - header_bytes;	// Chunk size
+
+// RIFF and format chunks (the data chunk's header after them is overwritten)
+	i = write_header(data, &riff, &fmt, dat) - sizeof(*dat);
+#if CAPT_ENCODE
+	fact.info.ckid[0] = 'f';		// Chunk ID: "fact"
+	fact.info.ckid[1] = 'a';
+	fact.info.ckid[2] = 'c';
+	fact.info.ckid[3] = 't';
+	fact.info.cksize = 4;			// Chunk size: 4
+// Sample count: whole blocks
+	fact.nsamples = (dat->cksize / CAPT_SLOT_SIZE) * CAPT_SLOT_SAMPLES;
+	write_fact(&data[i], &fact);
+	i += sizeof(fact);
+#endif
+	i += capt_stats_chunk(&data[i]);
+
+	junk.ckid[0] = 'J';				// Chunk ID: "JUNK"
+	junk.ckid[1] = 'U';
+	junk.ckid[2] = 'N';
+	junk.ckid[3] = 'K';
+// Chunk size: rest of the header, less the data chunk's header
+	junk.cksize = header_bytes - (i + sizeof(junk) + sizeof(*dat));
+	write_chunk(&data[i], &junk);
+	for (i += sizeof(junk); i < 512; i++) {
+		data[i] = 0x00;
+	}
+	if (header_bytes == 512) {
+		write_chunk(&data[512 - sizeof(*dat)], dat);
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copy the next blocks of the clip being saved, at most nbuf of them, or	  */
+/* commit the file once the whole clip is copied							  */
+/* The data buffer must hold nbuf blocks (at least one).					  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t clip_step(	uint8_t *data, uint16_t nbuf, struct fatstruct *info,
+					struct circstruct *circ, struct clipjob *job) {
+	uint16_t	nblocks;			// Number of blocks in the copy run
+	uint16_t	file_num;			// File name number suffix
+#if CIRC_GATE
+	uint16_t	i;
+	uint8_t		silent;				// Set if the run's blocks were left out
+#endif
+
+	if (job->track != job->bookmark) {
+/* Run of consecutive blocks: up to the bookmark or the end of the circular
+buffer */
+		nblocks = nbuf;
+		if (job->track < job->bookmark) {
+			if (nblocks > (job->bookmark - job->track) / 512)
+				nblocks = (job->bookmark - job->track) / 512;
+		} else {
+			if (nblocks > (circ->end - job->track) / 512)
+				nblocks = (circ->end - job->track) / 512;
+		}
+
+#if CIRC_GATE
+/* The run ends where the blocks change from written to left out or back.  The
+left out ones are written as silence. */
+		silent = circ_silent(circ, job->track);
+		for (i = 1; i < nblocks &&
+			circ_silent(circ, job->track + i * 512UL) == silent; i++);
+		nblocks = i;
+		if (silent) {
+			capt_silence(data);
+			if (write_multiple_start(job->block_offset, nblocks)) return 1;
+			for (i = 0; i < nblocks; i++) {
+				if (write_multiple_block(data)) return 1;
+			}
+			if (write_multiple_end()) return 1;
+		} else
+#endif
+		if (copy_blocks(data, nblocks, job->track, job->block_offset,
+			nblocks)) return 1;
+		job->block_offset += nblocks * 512UL;
+
+// Move tracker appropriately (within circular buffer)
+		job->track += nblocks * 512UL;
+		if (job->track == circ->end) {
+			job->track = circ->begin;
+		}
+		return 0;
+	}
+
+// The copy's write sessions went unchecked: check the card's status once
+	if (check_status_sd()) return 1;
+
+// Commit the cluster chain to the FATs
+	if (flush_fat(info)) return 1;
+
+/* Updating directory table */
+// Get appropriate number for file name suffix
+	file_num = get_file_num(info);
+// Update the directory table
+	if (update_dir_table(data, info, job->start_cluster, job->total_bytes,
+		file_num)) return 1;
+
+	job->start_cluster = 0;			// Saved
+	circ->keep = 0;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 while a clip is being saved										  */
+/*----------------------------------------------------------------------------*/
+uint8_t clip_busy(struct clipjob *job) {
+	return job->start_cluster != 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 if the block at offset holds part of the clip being saved that	  */
+/* is still to be copied (the recorder may not write it yet)				  */
+/* With CIRC_GATE, the recorder may not get CIRC_NMAP blocks ahead of the	  */
+/* copy either, as the silence map would no longer cover it.				  */
+/*----------------------------------------------------------------------------*/
+uint8_t clip_overrun(struct circstruct *circ, struct clipjob *job,
+						uint32_t offset) {
+	if (job->start_cluster == 0 || job->track == job->bookmark) return 0;
+#if CIRC_GATE
+	if ((offset >= job->track ? offset - job->track :
+		offset + (circ->end - circ->begin) - job->track) >=
+		CIRC_NMAP * 512UL) return 1;
+#endif
+	if (job->track < job->bookmark) {
+		return offset >= job->track && offset < job->bookmark;
+	}
+	return offset >= job->track || offset < job->bookmark;	// Wraps around
+}
+
+/*----------------------------------------------------------------------------*/
+/* Give up the clip being saved: its clusters are freed and its blocks		  */
+/* still to be copied are no longer kept from the recorder					  */
+/* No streaming session may be open.										  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t clip_abort(	struct fatstruct *info, struct circstruct *circ,
+					struct clipjob *job) {
+	uint16_t	clust;				// Cluster of the file's extent
+	uint16_t	nclusts;			// Number of clusters in the file
+
+	circ->keep = 0;
+	if (job->start_cluster == 0) return 0;
+
+// The file's clusters are one extent (see clip_begin())
+	nclusts = CLUST_QUOT(job->total_bytes + info->nbytesinclust - 1, info);
+	clust = job->start_cluster;
+	job->start_cluster = 0;
+	while (nclusts--) {
+		if (update_fat(info, clust * 2UL, 0)) return 1;
+		clust++;
+	}
+	return flush_fat(info);
+}
+
+#if CLIP_RELINK
+/*----------------------------------------------------------------------------*/
+/* Store the clip preceding bookmark in a new file							  */
+/* The clip's clusters are moved from the circular buffer's chain to the	  */
+/* file's chain and replaced by a fresh extent.  The file starts with a		  */
+/* header cluster (RIFF, format and capture statistics chunks, a JUNK		  */
+/* chunk filling the cluster and the data chunk's header in its last 8		  */
+/* bytes), so the audio stays cluster aligned; only its first and last		  */
+/* blocks are written.														  */
+/* The clip covers the whole clusters preceding the cluster being recorded,	  */
+/* so it can be up to a cluster longer than the clip length.  A clip taken	  */
+/* soon after circ_start() is only as long as the recording.				  */
+/* The data buffer must hold one block.										  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t save_clip(	uint8_t *data, struct fatstruct *info,
+					struct circstruct *circ, uint32_t bookmark) {
+	uint16_t	*seg;				// Clip's clusters, oldest first
+	uint16_t	next[CIRC_NHIST];	// FAT entries of the clip's clusters
+	uint8_t		nseg;				// Number of clusters in the clip
+	uint8_t		nhist;				// Clusters of hist that hold recording
+	uint16_t	nsects;				// Blocks recorded in the last cluster
+	uint16_t	header;				// File's header (starting) cluster
+	uint16_t	repl;				// First replacement cluster
+	uint16_t	first;				// First cluster of the circular buffer
+	uint16_t	file_num;			// File name number suffix
+	uint32_t	total_bytes;		// Total bytes in file
+	uint32_t	block_offset;
+	uint16_t	i;
+
+	struct ck		dat;			// Data chunk (info only--not actual data)
+
+/* Blocks recorded in the cluster being recorded; if none, the clip ends with
+the cluster before it */
+	nsects = (bookmark - circ->clustoffset) / 512;
+	nhist = circ->nhist;
+	if (nsects == 0) nhist--;
+	nseg = (nsects == 0) ? CLIP_NCLUSTS : CLIP_NCLUSTS + 1;
+	if (nseg > nhist) nseg = nhist;
+	if (nseg == 0) return 0;		// Nothing recorded
+	seg = &circ->hist[nhist - nseg];
+
+/* Total bytes: header cluster, whole clusters and the partial one */
+	total_bytes = (nseg + 1) * info->nbytesinclust;
+	if (nsects) {
+		total_bytes -= info->nbytesinclust - nsects * 512UL;
+	}
+
+// Chain links of the clip's clusters before they are changed
+	for (i = 0; i < nseg; i++) {
+		if ((next[i] = next_cluster(info, seg[i])) == 0) return 1;
+	}
+
+/* Allocate the replacement clusters (chained) and the header cluster */
+	if ((repl = alloc_extent(data, info, nseg)) == 0) return 1;
+	if ((header = find_cluster(data, info)) == 0) return 1;
+
+	FEED_WATCHDOG;
+
+/******************************************************************************/
+/* RELINKING																  */
+/******************************************************************************/
+
+/* Put the replacements in the circular buffer.  The cluster before the clip
+is the one recorded before it, unless the clip starts the circular buffer. */
+	first = circ->first;
+	if (seg[0] == first) {
+		circ->first = repl;
+	} else if (nhist > nseg) {
+		if (update_fat(info, seg[-1] * 2UL, repl)) return 1;
+	} else {
+		return 1;					// Recording always starts at first
+	}
+	for (i = 0; i < nseg; i++) {
+// A clip that wraps around continues at the first cluster
+		if (i > 0 && seg[i] == first) circ->first = repl + i;
+// Replacements are already chained where the clip's clusters were
+		if (i + 1 < nseg && next[i] == seg[i+1]) continue;
+		if (update_fat(info, (repl + i) * 2UL, next[i])) return 1;
+	}
+
+/* Chain the clip's clusters behind the header cluster */
+	if (update_fat(info, header * 2UL, seg[0])) return 1;
+	for (i = 0; i < nseg; i++) {
+		if (i + 1 < nseg) {
+			if (next[i] == seg[i+1]) continue;
+			if (update_fat(info, seg[i] * 2UL, seg[i+1])) return 1;
+		} else {
+			if (update_fat(info, seg[i] * 2UL, 0xFFFF)) return 1;
+		}
+	}
+
+	FEED_WATCHDOG;
+
+/******************************************************************************/
+/* FILE CREATION															  */
+/******************************************************************************/
+
+/* First block: RIFF, format, capture statistics and JUNK chunks */
+	write_clip_header(data, &dat, total_bytes, info->nbytesinclust);
+	block_offset = get_cluster_offset(header, info);
+	if (write_block(data, block_offset, 512)) return 1;
+
+/* Last block: data chunk header in the last 8 bytes */
+	for (i = 0; i < 512 - sizeof(dat); i++) {
+		data[i] = 0x00;
+	}
+	write_chunk(&data[512 - sizeof(dat)], &dat);
+	block_offset += info->nbytesinclust - 512;
+	if (write_block(data, block_offset, 512)) return 1;
+
+	FEED_WATCHDOG;
+
+// Commit the relinked chains to the FATs
+	if (flush_fat(info)) return 1;
+
+/* Updating directory table */
+// Get appropriate number for file name suffix
+	file_num = get_file_num(info);
+	FEED_WATCHDOG;
+// Update the directory table
+	if (update_dir_table(data, info, header, total_bytes, file_num))
+		return 1;
+
+/* Point the circular buffer file at its new first cluster */
+	if (circ->first != first) {
+		block_offset = circ->dteoffset - (circ->dteoffset % 512);
+		if (read_block(data, block_offset)) return 1;
+		i = circ->dteoffset % 512;
+		data[i+26] = (uint8_t)(circ->first);
+		data[i+27] = (uint8_t)(circ->first >> 8);
+		if (write_block(data, block_offset, 512)) return 1;
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Save the clip preceding bookmark (see save_clip()) and return the offset	  */
+/* at which recording continues: the start of the circular buffer, as the	  */
+/* clip's clusters have left it												  */
+/* No job is left for clip_step().											  */
+/* The data buffer must hold one block.										  */
+/* Return 0 on error.														  */
+/*----------------------------------------------------------------------------*/
+uint32_t clip_begin(uint8_t *data, struct fatstruct *info,
+					struct circstruct *circ, struct clipjob *job,
+					uint32_t bookmark) {
+	job->start_cluster = 0;
+	if (save_clip(data, info, circ, bookmark)) return 0;
+	return circ_start(info, circ);
+}
+
+#else
+/*----------------------------------------------------------------------------*/
+/* Start saving the clip preceding bookmark in a new file (see clip_step())	  */
+/* The file's clusters are allocated as one contiguous extent, so the clip is*/
+/* written sequentially with no FAT traffic in between, and its header block  */
+/* is written.  The capture statistics in it are the ones at the bookmark.	  */
+/* The data buffer must hold one block.										  */
+/* Return the offset at which recording continues (bookmark), 0 on error.	  */
+/*----------------------------------------------------------------------------*/
+uint32_t clip_begin(uint8_t *data, struct fatstruct *info,
+					struct circstruct *circ, struct clipjob *job,
+					uint32_t bookmark) {
+	uint16_t	nclusts;			// Number of clusters in the file
+	struct ck	dat;				// Data chunk (info only--not actual data)
+
+/* The file is a header block followed by the clip */
+	job->total_bytes = 512 + circ->cliplength;
+	nclusts = CLUST_QUOT(job->total_bytes + info->nbytesinclust - 1, info);
+
+/* Allocate the file's clusters as one chained extent.  If alloc_extent
+returns 0, the disk is full (or too fragmented) */
+	job->start_cluster = alloc_extent(data, info, nclusts);
+	if (job->start_cluster == 0) return 0;
+
+// First block offset
+	job->block_offset = get_cluster_offset(job->start_cluster, info);
+// File data may not reach circular buffer
+	if (job->block_offset + (uint32_t)nclusts * info->nbytesinclust >
+		circ->begin) {
+		clip_abort(info, circ, job);
+		return 0;
+	}
+
+/******************************************************************************/
+/* FILE CREATION															  */
+/******************************************************************************/
+
+// Write WAVE header in data buffer, padded so that the audio starts with the
+// second block (ADPCM blocks stay block aligned)
+	write_clip_header(data, &dat, job->total_bytes, 512);
+
+// Write first block of data
+	if (write_block(data, job->block_offset, 512)) {
+		clip_abort(info, circ, job);
+		return 0;
+	}
+	job->block_offset += 512;
+
+// Set tracker offset
+// File clip data location: track to bookmark
+	job->bookmark = bookmark;
+	job->track = bookmark - circ->cliplength;
+	if (job->track < circ->begin) {
+		job->track = circ->end - (circ->begin - job->track);
+	}
+	circ->keep = job->track;
+	circ->pend = 0;
+
+	return bookmark;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Store the clip preceding bookmark in a new file, with recording stopped	  */
+/* The data buffer must hold one block.  The clip is copied through the		  */
+/* whole sector ring (capt_buff), idle with recording stopped, so each read	  */
+/* and write session moves CAPT_NSLOTS blocks.								  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t save_clip(	uint8_t *data, struct fatstruct *info,
+					struct circstruct *circ, uint32_t bookmark) {
+	struct clipjob job;
+
+	if (clip_begin(data, info, circ, &job, bookmark) == 0) return 1;
+
+	FEED_WATCHDOG;
+
+// Copy the clip through the sector ring
+	while (clip_busy(&job)) {
+		if (clip_step(capt_buff, CAPT_NSLOTS, info, circ, &job)) return 1;
+		FEED_WATCHDOG;
+	}
+
+	return 0;
+}
+
+#endif
+
+#endif
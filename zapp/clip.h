@@ -0,0 +1,111 @@
+/**
+ * Clip storage library.
+ */
+
+#ifndef _CLIPLIB_H
+#define _CLIPLIB_H
+
+// Set to 1 to keep the circular buffer in the clusters of a hidden file and
+// save clips by relinking its clusters into the new file (no copying)
+#ifndef CLIP_RELINK
+#define CLIP_RELINK		0
+#endif
+
+// Circular buffer's location as absolute cluster numbers
+// (offset = cluster number * bytes per cluster)
+// In relink mode, only the number of clusters is used.
+#define CIRC_BUFF_CLUST_BEGIN	0xDEB8
+#define CIRC_BUFF_CLUST_END		0xEEB8
+
+// Length of file recording in clusters.  The time it covers depends on the
+// capture profile: with 32 KB clusters, 20 seconds of 8-bit samples at 8 kHz,
+// 41 seconds of ADPCM at 8 kHz, 5 seconds of 16-bit samples at 16 kHz.
+#define CLIP_NCLUSTS	5
+
+// Set to 0 to write every sector to the circular buffer.  By default, the
+// sectors that vad_silent() finds silent are left out: the silence map
+// records them, and clips get silence in their place (capt_silence()).  Not
+// available in relink mode, whose clips are never copied.
+#ifndef CIRC_GATE
+#define CIRC_GATE		(!CLIP_RELINK)
+#endif
+
+#if CIRC_GATE && CLIP_RELINK
+#error "CIRC_GATE is not available with CLIP_RELINK"
+#endif
+
+#if CIRC_GATE
+// Blocks covered by the silence map, behind the one being recorded: a power
+// of two, at least the blocks of a clip (CLIP_NCLUSTS clusters of up to 128
+// blocks), and a divisor of the circular buffer's 0x1000 clusters' blocks
+#define CIRC_NMAP		1024
+#endif
+
+#if CLIP_RELINK
+// Name of the file holding the circular buffer (8.3 format without the dot)
+#define CIRC_FILE_NAME	"ZAPPRINGBIN"
+#define CIRC_FILE_ATTR	0x06		// Hidden, system
+// Clusters remembered behind the one being recorded: a clip's clusters and
+// the one preceding them
+#define CIRC_NHIST		(CLIP_NCLUSTS + 2)
+#endif
+
+struct circstruct {					// Circular buffer on the SD card
+	uint32_t begin;					// Beginning offset of circular buffer
+	uint32_t end;					// Ending offset of circular buffer
+	uint32_t cliplength;			// Length of file recording in bytes
+#if CLIP_RELINK
+	uint16_t first;					// First cluster of the circular buffer
+	uint32_t dteoffset;				// Offset of its directory table entry
+	uint32_t clustoffset;			// Offset of the cluster being recorded
+// Clusters recorded since circ_start(), oldest first (last one is the
+// cluster being recorded)
+	uint16_t hist[CIRC_NHIST];
+	uint8_t nhist;					// Number of valid entries in hist
+#endif
+// Start of the clip being saved (0 if none), which streaming sessions may not
+// pre-erase
+	uint32_t keep;
+#if !CLIP_RELINK
+// Start of the clip waiting for it to be saved (0 if none), kept likewise
+	uint32_t pend;
+#endif
+#if CIRC_GATE
+// Silence map: a bit per block, set if the block was silent and not written
+// (see circ_mark()), for the last CIRC_NMAP blocks recorded
+	uint8_t silent[CIRC_NMAP / 8];
+#endif
+};
+
+struct clipjob {					// Clip being saved while recording goes on
+	uint16_t start_cluster;			// File's first cluster (0 if none)
+	uint32_t total_bytes;			// Total bytes in file
+	uint32_t block_offset;			// Next block of the file to write
+	uint32_t track;					// Next block of the clip to copy
+	uint32_t bookmark;				// End of the clip
+};
+
+uint8_t circ_open(uint8_t *data, struct fatstruct *, struct circstruct *);
+uint32_t circ_start(struct fatstruct *, struct circstruct *);
+uint32_t circ_next(struct fatstruct *, struct circstruct *, uint32_t offset);
+uint32_t circ_next_run(struct fatstruct *, struct circstruct *);
+uint32_t circ_run_blocks(struct fatstruct *, struct circstruct *,
+						uint32_t offset);
+#if CIRC_GATE
+void circ_mark(struct circstruct *, uint32_t offset, uint8_t silent);
+uint8_t circ_silent(struct circstruct *, uint32_t offset);
+#endif
+#if !CLIP_RELINK
+void circ_pend(struct circstruct *, uint32_t bookmark);
+#endif
+uint8_t save_clip(	uint8_t *data, struct fatstruct *,
+					struct circstruct *, uint32_t bookmark);
+uint32_t clip_begin(uint8_t *data, struct fatstruct *, struct circstruct *,
+					struct clipjob *, uint32_t bookmark);
+uint8_t clip_step(	uint8_t *data, uint16_t nbuf, struct fatstruct *,
+					struct circstruct *, struct clipjob *);
+uint8_t clip_busy(struct clipjob *);
+uint8_t clip_overrun(struct circstruct *, struct clipjob *, uint32_t offset);
+uint8_t clip_abort(struct fatstruct *, struct circstruct *, struct clipjob *);
+
+#endif
@@ -0,0 +1,1381 @@
+/**
+ * Host benchmark of the SD card and FAT16 storage path.
+ *
+ * Each operation is driven through the firmware code (sdfat.c, clip.c) on
+ * the SD card emulator, once per card timing profile, and the bus activity
+ * is reported per call: SPI bytes, commands, busy polls (bytes clocked while
+ * the card was programming), wait polls (bytes clocked before a data token)
+ * and modeled bus time.  Worst-case time per call is reported as well, since
+ * a single long stall is what loses audio.  Recordings go through the
+ * recorder of start_logging() (record.c), samples being taken at each SPI
+ * primitive as the sampling interrupts would (see recording()).  Then come
+ * the MCU cycles spent in the SPI primitives (from the USCI model in
+ * spi_host.c) and the cycles of the runtime library divisions (DIV32 and
+ * the like, see msp430f5310.h), a few hundred per call on the MSP430.
+ * bench_div is built with SDFAT_SECT512 off for comparison (make divcmp
+ * shows the two side by side).
+ *
+ * A block transfer through the per-byte, burst and DMA SPI primitives is
+ * compared first, with the card deselected.  bench_dma is built with block
+ * data moved by DMA (SDFAT_DMA).  The CTRL button state machine is then
+ * played press scripts on the RTC tick (see button_check()), and the LED
+ * patterns are played on it (see led_check()).
+ *
+ * Usage: bench [-f fill_percent] [image]
+ *     -f fill_percent	Mark this share of the clusters as used before
+ *						running (default 50)
+ *     image			Scratch image path (default bench.img, recreated)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <msp430f5310.h>
+#include "msp430f5310_extra.h"
+#include "sdfat.h"
+#include "spi.h"
+#include "clip.h"
+#include "adpcm.h"
+#include "capture.h"
+#include "vad.h"
+#include "trigger.h"
+#include "button.h"
+#include "led.h"
+#include "record.h"
+#include "sd_emu.h"
+
+#define IMAGE_SECTS		4000000		// ~2 GB card, holds the circular buffer
+#define IMAGE_SPC		64			// Sectors per cluster (32 KB clusters)
+
+#define DIR_ENTRIES		200			// Directory entries written by setup
+
+// Sample period (Timer0_A ticks at 12 MHz, see capt_profile) and time to fill
+// a sector
+#define SAMPLE_NS		(capt_profile.period * 1000000000ULL / CAPT_CLOCK_HZ)
+#define BUFF_PERIOD_MS	(CAPT_SLOT_SAMPLES * SAMPLE_NS / 1e6)
+
+#ifndef M_PI
+#define M_PI			3.14159265358979323846
+#endif
+
+// 10-bit conversion j of a sector marked with mark, with CAPT_ENCODE (see
+// produce()).  A mu-law code cannot tell 256 levels apart near full scale, so
+// the first sample holds the mark's high nibble and the others its low one.
+#if CAPT_MULAW
+#define MARK_NIBBLE(k)	(256 + 32 * (k))
+#define MARK_ADC(mark, j)	\
+	MARK_NIBBLE((j) == 0 ? (mark) >> 4 : (mark) & 0x0F)
+#else
+#define MARK_ADC(mark, j)	(384 + (mark))
+#endif
+
+// 10-bit conversion j of a loud sector of a test signal (see produce()): a
+// square wave at -12 dBFS (the quiet ones are mid-scale)
+#define LOUD_ADC(j)		((j) & 1 ? 640 : 384)
+
+// 10-bit conversion j of a voiced sector of a test signal: a square wave at
+// -30 dBFS, active for the voice activity detector but no event
+#define SPEECH_ADC(j)	((j) & 1 ? 528 : 496)
+
+#if CIRC_GATE
+// Sectors of a gated recording (see record_gated()): out of every GATED_PERIOD,
+// the first GATED_LOUD are loud
+#define GATED_SECTS		1024
+#define GATED_PERIOD	64
+#define GATED_LOUD		8
+#define GATED_IS_LOUD(k)	((k) % GATED_PERIOD < GATED_LOUD)
+#endif
+
+// No button tap during a recording (see recording())
+#define NO_TAP			0xFFFFFFFF
+
+// Detectors kept from deciding during a recording (see recording()): every
+// sector is kept, and no event is seen.  The marks (see produce()) are too
+// quiet for the voice activity detector, and their wrap is an event.
+#define HOLD_GATE		1
+#define HOLD_TRIG		2
+
+#if TRIG_ENABLE
+// Loud sectors of a triggered recording (see record_triggered()): an event,
+// another during its hold-off, and one as the hold-off ends
+#define EVENT_A			64
+#define EVENT_B			(EVENT_A + TRIG_HOLDOFF / 2)
+#define EVENT_C			(EVENT_A + TRIG_HOLDOFF)
+#endif
+
+// Samples that have reached the ring: with CAPT_ENCODE and CAPT_DMA, only
+// whole DMA transfers are encoded
+#if CAPT_ENCODE && CAPT_DMA
+#define NCAPTURED		(nsamples - nsamples % CAPT_RAW_SIZE)
+#else
+#define NCAPTURED		nsamples
+#endif
+
+/* Card timing profiles: SPI clock, then read, single/multi/pre-erased
+programming, stop, GC period (blocks) and GC stall (all times in
+microseconds) */
+static const struct sd_emu_model profiles[] = {
+	{ "fast",	6000000, 100,  400,  200,  100,  500,   0,      0 },
+	{ "slow",	6000000, 400, 4000, 1500,  800, 5000,   0,      0 },
+	{ "gc",		6000000, 100,  400,  200,  100,  500, 256, 100000 },
+	{ "stall",	6000000, 100,  400,  200,  100,  500, 256, 250000 },
+};
+
+// 'Stop Tran' and CMD12 busy time of a card slow to end its sessions (see
+// overrun_check()): a sector and a half's time, so that a clip's copy, which
+// ends two sessions per step, falls behind the recording
+#define SLUGGISH_STOP_US	((uint32_t)(BUFF_PERIOD_MS * 1500))
+
+// Blocks of the circular buffer beyond a clip in overrun_check()
+#define OVERRUN_GAP		16
+
+#if CIRC_GATE && TRIG_ENABLE
+// Voiced sectors of combined_check()'s recording after the event: the first
+// COMBINED_SPEECH out of every COMBINED_PERIOD, so each pause outlasts the
+// hangover by as many
+#define COMBINED_SPEECH	32
+#define COMBINED_PERIOD	(2 * COMBINED_SPEECH + VAD_HANGOVER)
+#endif
+
+#if !CLIP_RELINK && TRIG_ENABLE
+// Loud sector of pending_check()'s and combined_check()'s recordings
+static uint32_t one_event;
+// Clip lengths in the circular buffer of pending_check(), cut short so that
+// the recording wraps around within it
+#define PENDING_NCLIPS	6
+#endif
+
+struct result {						// Totals for one operation
+	uint32_t calls;
+	struct sd_emu_stats sum;
+	uint64_t max_ns;
+	uint64_t div_cycles;			// MCU cycles in library divisions
+	uint64_t cycles;				// MCU cycles in the SPI primitives
+};
+
+static uint8_t data[1024];			// Two adjacent blocks, as in main.c
+static struct fatstruct info;
+static struct circstruct circ;
+static struct recorder rec;
+
+static struct sd_emu_stats before;
+static uint64_t div_before;
+static uint64_t cycles_before;
+
+static uint64_t next_sample;		// Modeled time of the next sample
+static uint64_t nsamples;			// Samples taken since recording started
+#if CAPT_ENCODE && CAPT_DMA
+static uint16_t *raw_dst;			// Conversions filled by the DMA stand-in
+#elif CAPT_DMA
+static uint8_t *dma_dst;			// Slot being filled by the DMA stand-in
+#endif
+static uint64_t sleep_ns;			// Time asleep waiting for sectors
+// Set if the card's GC stalls are short enough for the ring, with CAPT_LEND
+// slots lent, to hold the audio captured meanwhile: no sector may be lost
+static uint8_t lossless;
+static uint64_t save_ns;			// Time from a tap to its clip saved
+// Loud sectors of the test signal being recorded (marks if none), and its
+// voiced ones (none if not set)
+static uint8_t (*loud)(uint32_t k);
+static uint8_t (*voiced)(uint32_t k);
+/* What the last recording saw (see recording()) */
+static uint32_t nclips;				// Clips begun
+static uint32_t clip_at[2];			// Sectors recorded before the first two
+static uint16_t clip_first[2];		// Their first clusters
+static uint32_t nsessions;			// Streaming sessions opened
+static uint32_t naborts;			// Clips given up on an overrun
+static uint32_t abort_at;			// Sectors recorded before the last one
+static uint32_t nwaiting;			// Sectors recorded with a clip waiting
+#if CIRC_GATE
+static uint8_t gated_kept[GATED_SECTS];	// Its first sectors written
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Bracket one call of the operation being measured							  */
+/*----------------------------------------------------------------------------*/
+static void begin(void) {
+	before = sd_emu_stats;
+	div_before = host_div_cycles;
+	cycles_before = spi_host_cycles;
+}
+
+static void end(struct result *r) {
+	uint64_t t = sd_emu_stats.time_ns - before.time_ns;
+	r->calls++;
+	r->sum.bytes += sd_emu_stats.bytes - before.bytes;
+	r->sum.cmds += sd_emu_stats.cmds - before.cmds;
+	r->sum.busy_polls += sd_emu_stats.busy_polls - before.busy_polls;
+	r->sum.wait_polls += sd_emu_stats.wait_polls - before.wait_polls;
+	r->sum.time_ns += t;
+	r->div_cycles += host_div_cycles - div_before;
+	r->cycles += spi_host_cycles - cycles_before;
+	if (t > r->max_ns) r->max_ns = t;
+}
+
+static void report(const char *name, struct result *r) {
+	double n = r->calls ? r->calls : 1;
+	printf("  %-18s %6u %10.0f %7.1f %9.0f %9.0f %9.3f %9.3f %9.1f %7.0f\n",
+		name, r->calls, r->sum.bytes / n, r->sum.cmds / n,
+		r->sum.busy_polls / n, r->sum.wait_polls / n,
+		r->sum.time_ns / n / 1e6, r->max_ns / 1e6, r->cycles / n / 1e3,
+		r->div_cycles / n);
+	memset(r, 0, sizeof(*r));
+}
+
+static void fail(const char *what) {
+	fprintf(stderr, "bench: %s failed\n", what);
+	exit(1);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Create and mount a fresh image with fill_percent of the clusters in use	  */
+/* and DIR_ENTRIES directory entries										  */
+/*----------------------------------------------------------------------------*/
+static void setup(const char *path, const struct sd_emu_model *m,
+		unsigned fill_percent) {
+	uint32_t nused, i;
+
+	if (sd_emu_mkfs(path, IMAGE_SECTS, IMAGE_SPC)) fail("mkfs");
+	if (sd_emu_open(path, m)) fail("open");
+	spi_config();
+	if (init_sd()) fail("init_sd");
+	if (read_boot_sector(data, &info)) fail("read_boot_sector");
+	if (parse_boot_sector(data, &info)) fail("parse_boot_sector");
+
+/* Mark clusters 2 .. nused+1 as single-cluster files */
+	nused = (info.nclusts - 2UL) * fill_percent / 100;
+	for (i = 0; i < (nused + 2) * 2; i += 512) {
+		memset(data, 0, 512);
+		for (uint32_t j = 0; j < 512 && i + j < (nused + 2) * 2; j += 2) {
+			data[j] = data[j + 1] = 0xFF;
+		}
+		if (i == 0) data[0] = 0xF8;
+		if (write_block(data, info.fatoffset + i, 512)) fail("fill");
+		if (write_block(data, info.fatoffset + info.fatsize + i, 512))
+			fail("fill");
+	}
+
+/* Directory of earlier clips, the last one deleted (its slot is the first
+free one) */
+	for (i = 0; i < DIR_ENTRIES * 32; i += 32) {
+		if (i % 512 == 0) memset(data, 0, 512);
+		memcpy(&data[i % 512], "DATA000 WAV", 11);
+		data[i % 512 + 4] = '0' + (i / 32 + 1) / 100 % 10;
+		data[i % 512 + 5] = '0' + (i / 32 + 1) / 10 % 10;
+		data[i % 512 + 6] = '0' + (i / 32 + 1) % 10;
+		if (i == (DIR_ENTRIES - 1) * 32) data[i % 512] = 0xE5;
+		if (i % 512 == 480 || i == (DIR_ENTRIES - 1) * 32) {
+			if (write_block(data, info.dtoffset + i - i % 512, 512))
+				fail("fill");
+		}
+	}
+
+	sd_emu_reset_stats();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Mount-time FAT and directory scans and circular buffer lookup (created on  */
+/* first mount in relink mode)												  */
+/*----------------------------------------------------------------------------*/
+static void mount(struct result *r) {
+	begin();
+	if (scan_fat(data, &info)) fail("scan_fat");
+	end(r);
+	report("scan_fat (mount)", r);
+
+	begin();
+	if (scan_dir(data, &info)) fail("scan_dir");
+	end(r);
+	report("scan_dir (mount)", r);
+
+	begin();
+	if (circ_open(data, &info, &circ)) fail("circ_open");
+	end(r);
+	report("circ_open", r);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Empty the ring and start sampling, as start_logging() does				  */
+/*----------------------------------------------------------------------------*/
+static void capture_start(void) {
+	capt_reset();
+#if CAPT_ENCODE && CAPT_DMA
+	raw_dst = capt_raw_swap();
+#elif CAPT_DMA
+	dma_dst = capt_fill_slot();
+#endif
+	nsamples = 0;
+	next_sample = sd_emu_stats.time_ns + SAMPLE_NS;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Sampling stand-in: take every sample due by now, through the DMA			  */
+/* interrupt's hand-over with CAPT_DMA or the sampling interrupt's otherwise  */
+/* Sector k of the recording is marked with k % 256: all its bytes with 8-bit*/
+/* PCM, its samples with CAPT_ENCODE (see MARK_ADC), unless a test signal	  */
+/* is being recorded (see LOUD_ADC and SPEECH_ADC).  Samples are taken at	  */
+/* the capture profile's rate.												  */
+/*----------------------------------------------------------------------------*/
+static void produce(void) {
+	uint32_t k;						// Sector of the sample
+	uint16_t v;						// Sample as captured
+
+	while (sd_emu_stats.time_ns >= next_sample) {
+		k = (uint32_t)(nsamples / CAPT_SLOT_SAMPLES);
+#if CAPT_ENCODE
+		v = MARK_ADC((uint8_t)k, nsamples % CAPT_SLOT_SAMPLES);
+#elif CAPT_PCM16
+		v = (uint8_t)k * 0x0101;
+#else
+		v = (uint8_t)k;
+#endif
+		if (loud) {
+			v = loud(k) ? LOUD_ADC(nsamples % CAPT_SLOT_SAMPLES) :
+				voiced && voiced(k) ? SPEECH_ADC(nsamples % CAPT_SLOT_SAMPLES) :
+				512;
+			if (!CAPT_ENCODE) v = CAPT_PCM16 ? (v << 6) ^ 0x8000 : v >> 2;
+		}
+#if CAPT_ENCODE && CAPT_DMA
+		raw_dst[nsamples % CAPT_RAW_SIZE] = v;
+		if (nsamples % CAPT_RAW_SIZE == CAPT_RAW_SIZE - 1) {
+			raw_dst = capt_raw_swap();
+			capt_raw_encode();
+		}
+#elif CAPT_ENCODE
+		capt_put_adc(v);
+#elif CAPT_DMA
+		dma_dst[nsamples % CAPT_SLOT_SAMPLES * (capt_profile.bits / 8)] = (uint8_t)v;
+		if (CAPT_PCM16) dma_dst[nsamples % CAPT_SLOT_SAMPLES * 2 + 1] = (uint8_t)(v >> 8);
+		if (nsamples % CAPT_SLOT_SAMPLES == CAPT_SLOT_SAMPLES - 1) {
+			dma_dst = capt_block_done();
+		}
+#elif CAPT_PCM16
+		capt_put16(v);
+#else
+		capt_put((uint8_t)v);
+#endif
+		nsamples++;
+		next_sample += SAMPLE_NS;
+	}
+}
+
+#if !CLIP_RELINK
+/*----------------------------------------------------------------------------*/
+/* Return the mark of a recorded block (see produce()), or -1 if the block	  */
+/* does not hold one mark throughout										  */
+/*----------------------------------------------------------------------------*/
+static int block_mark(const uint8_t *block) {
+#if CAPT_ADPCM
+	struct adpcmstate st;
+	int16_t first = (int16_t)(block[0] | block[1] << 8);
+	uint16_t i;
+	int d;
+
+/* The header holds the first sample as is; the others decode to it within
+a 10-bit step */
+	st.predictor = first;
+	st.index = block[2];
+	for (i = ADPCM_HEADER_SIZE; i < CAPT_SLOT_SIZE; i++) {
+		d = adpcm_decode(&st, block[i] & 0x0F) - first;
+		if (d < -64 || d > 64) return -1;
+		d = adpcm_decode(&st, block[i] >> 4) - first;
+		if (d < -64 || d > 64) return -1;
+	}
+	return (uint8_t)((first >> 6) + 128);
+#elif CAPT_MULAW
+	int hi = -1, lo = -1, k;
+
+	if (memcmp(block + 1, block + 2, CAPT_SLOT_SIZE - 2)) return -1;
+	for (k = 0; k < 16; k++) {
+		if (block[0] == capt_mulaw[MARK_NIBBLE(k)]) hi = k;
+		if (block[1] == capt_mulaw[MARK_NIBBLE(k)]) lo = k;
+	}
+	if (hi < 0 || lo < 0) return -1;
+	return hi << 4 | lo;
+#else
+	if (memcmp(block, block + 1, CAPT_SLOT_SIZE - 1)) return -1;
+	return block[0];
+#endif
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Record nblocks sectors through the recorder (record.c) the way			  */
+/* start_logging() drives it, with a button tap after tap sectors (none if	  */
+/* NO_TAP), until the clips asked for are saved, then stop it				  */
+/* Samples arrive in the ring at the capture profile's rate of modeled time,  */
+/* taken at each SPI primitive (see spi_host_isr) and while the CPU sleeps	  */
+/* with the ring empty (the time is added to sleep_ns).  Only the time spent  */
+/* on a sector or with the ring drained counts.  The detectors in hold are	  */
+/* kept from deciding (see HOLD_GATE).  The clips begun and given up, the	  */
+/* sessions opened and the sectors written are noted (see nclips), and the	  */
+/* time from the last save asked for to its clip saved goes to save_ns.  The  */
+/* ring's statistics are checked against the sectors produced and written,	  */
+/* none of which may be lost if lossless is set.							  */
+/* Return the bookmark.														  */
+/*----------------------------------------------------------------------------*/
+static uint32_t recording(struct result *r, uint32_t nblocks, uint32_t tap,
+						uint8_t hold) {
+	uint32_t i = 0, offset;
+	uint8_t *sect, streaming, asked, busy;
+	uint64_t t_ask = 0;
+
+	rec_start(&info, &circ, &rec);
+	capture_start();
+	nclips = nsessions = naborts = nwaiting = 0;
+	spi_host_isr = produce;
+	while (i < nblocks || rec.save || clip_busy(&rec.job)) {
+		produce();
+		if (i == tap) {
+			tap = NO_TAP;
+			if (!clip_busy(&rec.job) && !rec.save) {
+				rec.save = 1;
+				t_ask = sd_emu_stats.time_ns;
+			}
+		}
+		if ((sect = capt_peek()) == 0) {
+			if (rec_idle(&rec)) {
+				sleep_ns += next_sample - sd_emu_stats.time_ns;
+				sd_emu_idle((uint32_t)(next_sample - sd_emu_stats.time_ns));
+				continue;
+			}
+/* Ring drained: work on the clip until a sector is waiting */
+			asked = rec.save;
+			begin();
+			if (rec_drained(&info, &circ, &rec)) fail("rec_drained");
+			end(r);
+			if (asked && !rec.save) {
+				if (nclips < 2) {
+					clip_at[nclips] = i;
+					clip_first[nclips] = rec.job.start_cluster;
+				}
+				nclips++;
+			}
+			if (!clip_busy(&rec.job)) save_ns = sd_emu_stats.time_ns - t_ask;
+			continue;
+		}
+#if CIRC_GATE
+		if (hold & HOLD_GATE) rec.vad.hang = VAD_HANGOVER;
+#endif
+#if TRIG_ENABLE
+		if (hold & HOLD_TRIG) rec.trig.holdoff = TRIG_HOLDOFF;
+#endif
+		asked = rec.save;
+		streaming = rec.streaming;
+		busy = clip_busy(&rec.job);
+		offset = rec.offset;
+		begin();
+		if (rec_sector(sect, &info, &circ, &rec)) fail("rec_sector");
+		end(r);
+		if (rec.save && !asked) t_ask = sd_emu_stats.time_ns;
+		if (busy && !clip_busy(&rec.job)) {
+			naborts++;
+			abort_at = i;
+		}
+		if (rec.streaming && !streaming) nsessions++;
+		if (rec.save && clip_busy(&rec.job)) nwaiting++;
+#if CIRC_GATE
+		if (i < GATED_SECTS) gated_kept[i] = !circ_silent(&circ, offset);
+#else
+		(void)offset;
+#endif
+		i++;
+	}
+	spi_host_isr = 0;
+	begin();
+	if (rec_stop(&info, &circ, &rec)) fail("rec_stop");
+	end(r);
+
+	produce();
+	if (capt_stats.nsects != NCAPTURED / CAPT_SLOT_SAMPLES ||
+		capt_stats.ndropped != capt_stats.nsects - i - capt_backlog())
+		fail("capture statistics");
+	if (lossless && capt_stats.ndropped) fail("lossless recording");
+	return rec.offset;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Record nblocks with a button tap after tap blocks, the clip saved while	  */
+/* recording goes on (see recording())										  */
+/* In copy mode, the clip's audio is checked against the sectors recorded	  */
+/* before the bookmark.														  */
+/*----------------------------------------------------------------------------*/
+static void record_save(struct result *r, uint32_t nblocks, uint32_t tap) {
+	uint32_t offset, i;
+
+	recording(r, nblocks, tap, HOLD_GATE | HOLD_TRIG);
+	if (nclips != 1) fail("clip save");
+
+#if !CLIP_RELINK
+/* The clip's format chunk, after the RIFF chunk, holds the capture profile */
+	offset = get_cluster_offset(clip_first[0], &info);
+	if (read_block(data, offset)) fail("read_block");
+	if (memcmp(data + 12, "fmt ", 4) ||
+		(data[20] | data[21] << 8) != capt_profile.format ||
+		(data[24] | data[25] << 8 | (uint32_t)data[26] << 16 |
+		(uint32_t)data[27] << 24) != capt_profile.nsamplerate ||
+		(data[32] | data[33] << 8) != capt_profile.nblockalign ||
+		data[34] != capt_profile.bits)
+		fail("clip format");
+
+/* The clip ends with the last sector recorded before the bookmark (the marks
+skip the sectors lost, if any) */
+	offset += 512;
+	for (i = 0; i < circ.cliplength / 512 && capt_stats.ndropped == 0;
+		i++, offset += 512) {
+		if (read_block(data, offset)) fail("read_block");
+		if (block_mark(data) !=
+			(uint8_t)(clip_at[0] - circ.cliplength / 512 + i))
+			fail("clip audio");
+	}
+#else
+	(void)offset;
+	(void)i;
+#endif
+}
+
+#if CIRC_GATE
+/*----------------------------------------------------------------------------*/
+/* Check the gate's decisions on the first GATED_SECTS sectors of the test	  */
+/* signal just recorded: the sectors written must be the loud or voiced ones  */
+/* and the VAD_HANGOVER following each, unless sectors were lost (sector i	  */
+/* would not be sector i of the recording)									  */
+/* Return the sectors written.												  */
+/*----------------------------------------------------------------------------*/
+static uint32_t gate_check(void) {
+	uint32_t i, k, nwritten = 0;
+
+	for (i = 0; i < GATED_SECTS; i++) nwritten += gated_kept[i];
+	for (i = 0; i < GATED_SECTS && capt_stats.ndropped == 0; i++) {
+		for (k = i + 1; k > 0 && i - (k - 1) <= VAD_HANGOVER; k--) {
+			if (loud(k - 1) || (voiced && voiced(k - 1))) break;
+		}
+		if (gated_kept[i] != (k > 0 && i - (k - 1) <= VAD_HANGOVER))
+			fail("voice activity detection");
+	}
+	return nwritten;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 if sector k of a gated recording is loud						  */
+/*----------------------------------------------------------------------------*/
+static uint8_t gated_loud(uint32_t k) {
+	return GATED_IS_LOUD(k);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Record GATED_SECTS sectors of mostly silence (see GATED_IS_LOUD) with the  */
+/* gate deciding, then save the clip preceding the end with recording		  */
+/* stopped																	  */
+/* The gate's decisions are checked (see gate_check()); the clip must hold	  */
+/* the sectors written as recorded and silence in place of the others.  The	  */
+/* save goes to save_ns.													  */
+/*----------------------------------------------------------------------------*/
+static uint32_t record_gated(struct result *r) {
+	struct clipjob job;
+	uint32_t offset, i, nwritten;
+	uint16_t start;
+	uint64_t t;
+
+	loud = gated_loud;
+	offset = recording(r, GATED_SECTS, NO_TAP, HOLD_TRIG);
+	nwritten = gate_check();
+	loud = 0;
+
+/* Save the clip */
+	t = sd_emu_stats.time_ns;
+	if (clip_begin(data, &info, &circ, &job, offset) == 0) fail("clip_begin");
+	start = job.start_cluster;
+	while (clip_busy(&job)) {
+		if (clip_step(data, 2, &info, &circ, &job)) fail("clip_step");
+	}
+	save_ns = sd_emu_stats.time_ns - t;
+
+/* Each block of the clip: as recorded, or silence */
+	offset = get_cluster_offset(start, &info) + 512;
+	for (i = GATED_SECTS - circ.cliplength / 512; i < GATED_SECTS;
+		i++, offset += 512) {
+		if (read_block(data, offset)) fail("read_block");
+		if (gated_kept[i]) {
+			if (read_block(data + 512, circ.begin + i * 512)) fail("read_block");
+		} else {
+			capt_silence(data + 512);
+		}
+		if (memcmp(data, data + 512, 512)) fail("gated clip audio");
+	}
+	return nwritten;
+}
+#endif
+
+#if TRIG_ENABLE
+/*----------------------------------------------------------------------------*/
+/* Return 1 if sector k of a triggered recording is loud					  */
+/*----------------------------------------------------------------------------*/
+static uint8_t event_loud(uint32_t k) {
+	return k == EVENT_A || k == EVENT_B || k == EVENT_C;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Record nblocks sectors of silence and events (see EVENT_A) with the		  */
+/* trigger deciding, a clip saved in the background on each trigger			  */
+/* Return the clips saved (see nclips); the time from the last trigger to	  */
+/* its clip saved goes to save_ns.											  */
+/*----------------------------------------------------------------------------*/
+static uint32_t record_triggered(struct result *r, uint32_t nblocks) {
+	loud = event_loud;
+	recording(r, nblocks, NO_TAP, HOLD_GATE);
+	loud = 0;
+
+/* One clip per event outside the hold-off, each bookmarked once the event's
+post-trigger window is written (and the sectors waiting then), unless sectors
+were lost */
+	if (capt_stats.ndropped == 0 && (nclips != 2 ||
+		clip_at[0] - (EVENT_A + TRIG_POST + 1) >= CAPT_NSLOTS ||
+		clip_at[1] - (EVENT_C + TRIG_POST + 1) >= CAPT_NSLOTS))
+		fail("event trigger");
+	return nclips;
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Check that alloc_extent() finds a free run straddling the next free		  */
+/* cluster hint: the FAT is cut short past the run, so only the wrap-around	  */
+/* pass can find it															  */
+/*----------------------------------------------------------------------------*/
+static void straddle_check(void) {
+	uint16_t first, nclusts = info.nclusts;
+	uint8_t i;
+
+	if ((first = alloc_extent(data, &info, 6)) == 0) fail("alloc_extent");
+	for (i = 0; i < 6; i++) {
+		if (update_fat(&info, (first + i) * 2UL, 0)) fail("update_fat");
+	}
+	info.nclusts = first + 6;
+	info.nextfree = first + 3;
+	if (alloc_extent(data, &info, 6) != first)
+		fail("alloc_extent across the hint");
+	info.nclusts = nclusts;
+	if (flush_fat(&info)) fail("flush_fat");
+}
+
+/*----------------------------------------------------------------------------*/
+/* Run every operation under one profile									  */
+/*----------------------------------------------------------------------------*/
+static void run(const char *path, const struct sd_emu_model *m,
+		unsigned fill_percent) {
+	struct result r, scratch;
+	uint16_t clust[8];
+	uint64_t t, div;
+	uint32_t base, offset;
+#if CIRC_GATE || TRIG_ENABLE
+	uint32_t n;
+#endif
+	int i;
+
+	setup(path, m, fill_percent);
+	memset(&r, 0, sizeof(r));
+	memset(&scratch, 0, sizeof(scratch));
+
+	printf("profile %s (%u%% full, %s clips, %s arithmetic)\n", m->name,
+		fill_percent, CLIP_RELINK ? "relinked" : "copied",
+		SDFAT_SECT512 ? "512-byte" : "generic");
+	if (SDFAT_DMA) printf("  (block data moved by DMA)\n");
+	lossless = m->gc_us <= (CAPT_NSLOTS - CAPT_LEND) * CAPT_SLOT_US;
+	if (!lossless) {
+		printf("  (GC stalls longer than the %lu ms of audio the ring holds: "
+			"sectors may be lost)\n",
+			(unsigned long)((CAPT_NSLOTS - CAPT_LEND) * CAPT_SLOT_US / 1000));
+	}
+	printf("  (samples captured at %.3f kHz %s, stored as %s)\n",
+		1e6 / SAMPLE_NS, CAPT_DMA ?
+		(CAPT_ENCODE ? "by DMA, one interrupt per transfer" :
+		"by DMA, one interrupt per sector") : "one per interrupt",
+		CAPT_ADPCM ? "IMA ADPCM" : CAPT_MULAW ? "mu-law" :
+		CAPT_PCM16 ? "16-bit PCM" : "8-bit PCM");
+	printf("  %-18s %6s %10s %7s %9s %9s %9s %9s %9s %7s\n", "operation",
+		"calls", "bytes", "cmds", "busy", "wait", "ms", "max ms", "kcycles",
+		"div cyc");
+
+	mount(&r);
+
+/* Block writes and reads, checking that each block reads back as written */
+	base = circ_start(&info, &circ);
+	for (i = 0, offset = base; i < 256; i++, offset += 512) {
+		memset(data, i, 512);
+		begin();
+		if (write_block(data, offset, 512)) fail("write_block");
+		end(&r);
+	}
+	report("write_block", &r);
+
+	for (i = 0, offset = base; i < 256; i++, offset += 512) {
+		begin();
+		if (read_block(data, offset)) fail("read_block");
+		end(&r);
+		if (data[0] != (uint8_t)i || memcmp(data, data + 1, 511))
+			fail("read back");
+	}
+	report("read_block", &r);
+
+/* Circular buffer recording: one block per buffer */
+	sleep_ns = 0;
+	t = sd_emu_stats.time_ns;
+	div = host_div_cycles;
+	recording(&r, 1024, NO_TAP, HOLD_GATE | HOLD_TRIG);
+	report("record (ring)", &r);
+	printf("  (ring: %u of %u slots deep at most, worst wait %.1f ms, %u "
+		"sectors lost)\n", capt_stats.maxbacklog, CAPT_NSLOTS,
+		capt_stats.maxlatency * BUFF_PERIOD_MS / CAPT_SLOT_SAMPLES,
+		capt_stats.ndropped);
+	printf("  (CPU asleep in LPM0 %.1f%% of the recording, %.0f cycles of "
+		"library divisions per sector captured)\n",
+		100.0 * sleep_ns / (sd_emu_stats.time_ns - t),
+		(double)(host_div_cycles - div) / capt_stats.nsects);
+
+/* Recording with a clip saved in the background */
+	record_save(&r, 2048, 512);
+	report("record+save (ring)", &r);
+	printf("  (clip saved %.0f ms after the tap; ring: %u of %u slots deep at "
+		"most, worst wait %.1f ms, %u sectors lost)\n", save_ns / 1e6,
+		capt_stats.maxbacklog, CAPT_NSLOTS,
+		capt_stats.maxlatency * BUFF_PERIOD_MS / CAPT_SLOT_SAMPLES,
+		capt_stats.ndropped);
+	printf("  (%u streaming sessions opened, %u clips given up on an "
+		"overrun)\n", nsessions, naborts);
+
+#if CIRC_GATE
+/* Mostly silent recording, silent sectors left out */
+	sleep_ns = 0;
+	t = sd_emu_stats.time_ns;
+	n = record_gated(&r);
+	report("record (gated)", &r);
+	printf("  (%u of %u sectors written in %u sessions, VAD hangover %u; "
+		"clip saved in %.0f ms)\n", n, GATED_SECTS, nsessions, VAD_HANGOVER,
+		save_ns / 1e6);
+	printf("  (CPU asleep in LPM0 %.1f%% of the recording)\n",
+		100.0 * sleep_ns / (sd_emu_stats.time_ns - t));
+#endif
+
+#if TRIG_ENABLE
+/* Silent recording with events, clips saved on the triggers */
+	n = record_triggered(&r, EVENT_C + TRIG_POST + CAPT_NSLOTS);
+	report("record (trigger)", &r);
+	printf("  (%u of 2 clips saved, post-trigger window %u sectors, last one "
+		"saved %.0f ms after the trigger)\n", n, TRIG_POST, save_ns / 1e6);
+	printf("  (%u streaming sessions opened, %u clips given up on an "
+		"overrun)\n", nsessions, naborts);
+	if (n == 2) {
+		printf("  (bookmarked %u and %u sectors after the events)\n",
+			clip_at[0] - EVENT_A - 1, clip_at[1] - EVENT_C - 1);
+	}
+#endif
+
+	for (i = 0; i < 8; i++) {
+		begin();
+		if ((clust[i] = find_cluster(data, &info)) == 0) fail("find_cluster");
+		end(&r);
+	}
+	report("find_cluster", &r);
+
+	for (i = 0; i < 7; i++) {
+		begin();
+		if (update_fat(&info, clust[i] * 2UL, clust[i + 1]))
+			fail("update_fat");
+		end(&r);
+	}
+	report("update_fat", &r);
+
+	begin();
+	if (flush_fat(&info)) fail("flush_fat");
+	end(&r);
+	report("flush_fat", &r);
+
+	for (i = 0; i < 8; i++) {
+		begin();
+		if (alloc_extent(data, &info, 6) == 0) fail("alloc_extent");
+		if (flush_fat(&info)) fail("flush_fat");
+		end(&r);
+	}
+	report("alloc_extent+flush", &r);
+	straddle_check();
+
+	for (i = 0; i < 8; i++) {
+		begin();
+		get_file_num(&info);
+		end(&r);
+	}
+	report("get_file_num", &r);
+
+	for (i = 0; i < 8; i++) {
+		begin();
+		if (update_dir_table(data, &info, clust[i], 512, i + 1))
+			fail("update_dir_table");
+		end(&r);
+	}
+	report("update_dir_table", &r);
+
+/* Clip save after recording most of the way around the circular buffer, then
+after a wrap (recording not counted) */
+	for (i = 0; i < 2; i++) {
+		offset = recording(&scratch, (CIRC_BUFF_CLUST_END -
+			CIRC_BUFF_CLUST_BEGIN - 4 + 6 * i) * (uint32_t)IMAGE_SPC + 100,
+			NO_TAP, HOLD_GATE | HOLD_TRIG);
+		begin();
+		if (save_clip(data, &info, &circ, offset)) fail("save_clip");
+		end(&r);
+	}
+	report("save_clip", &r);
+
+	printf("\n");
+	sd_emu_close();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Give up on a card that stays busy after a block write					  */
+/*----------------------------------------------------------------------------*/
+static void busy_timeout(const char *path) {
+	static const struct sd_emu_model stuck =
+		{ "stuck", 6000000, 100, 400, 200, 100, 500, 1, 5000000 };
+	struct sd_emu_stats t0;
+
+	setup(path, &profiles[0], 0);
+	if (scan_fat(data, &info) || scan_dir(data, &info) ||
+		circ_open(data, &info, &circ)) fail("mount");
+	sd_emu_set_model(&stuck);
+
+	if (write_multiple_start(circ_start(&info, &circ), 0))
+		fail("write_multiple_start");
+	if (write_multiple_send(data)) fail("write_multiple_send");
+	t0 = sd_emu_stats;
+	if (write_wait() == 0) fail("busy timeout");
+	if (write_poll() != SD_READY) fail("busy timeout state");
+	printf("busy timeout after %.1f ms (%llu polls, card busy 5 s)\n\n",
+		(sd_emu_stats.time_ns - t0.time_ns) / 1e6,
+		(unsigned long long)(sd_emu_stats.busy_polls - t0.busy_polls));
+	sd_emu_close();
+}
+
+#if !CLIP_RELINK
+/*----------------------------------------------------------------------------*/
+/* Save a clip from a circular buffer cut short to the clip and OVERRUN_GAP	  */
+/* blocks, on a card slow to end its sessions (see SLUGGISH_STOP_US)		  */
+/* The recording catches up with the copy: the clip must be given up, with	  */
+/* its clusters freed and no directory entry, and recording go on.			  */
+/*----------------------------------------------------------------------------*/
+static void overrun_check(const char *path) {
+	struct sd_emu_model sluggish = profiles[0];
+	struct result r;
+	uint32_t tap;
+	uint16_t nfree, filenum;
+
+	setup(path, &profiles[0], 50);
+	if (scan_fat(data, &info) || scan_dir(data, &info) ||
+		circ_open(data, &info, &circ)) fail("mount");
+	sluggish.name = "sluggish";
+	sluggish.stop_us = SLUGGISH_STOP_US;
+	sd_emu_set_model(&sluggish);
+	memset(&r, 0, sizeof(r));
+	lossless = 1;
+
+	circ.end = circ.begin + circ.cliplength + OVERRUN_GAP * 512UL;
+	nfree = info.nfreeclusts;
+	filenum = info.nextfilenum;
+	tap = circ.cliplength / 512 + OVERRUN_GAP;
+	recording(&r, tap + 8 * OVERRUN_GAP, tap, HOLD_GATE | HOLD_TRIG);
+	if (nclips != 1 || naborts != 1 || info.nfreeclusts != nfree)
+		fail("clip overrun");
+
+/* The FAT and the directory on the card as before the clip */
+	if (scan_fat(data, &info) || scan_dir(data, &info)) fail("mount");
+	if (info.nfreeclusts != nfree || info.nextfilenum != filenum)
+		fail("clip overrun cleanup");
+	printf("clip overrun: copy given up %u sectors after the tap, recording "
+		"went on for %u more (%u sectors lost)\n\n", abort_at - tap,
+		tap + 8 * OVERRUN_GAP - abort_at - 1, capt_stats.ndropped);
+	sd_emu_close();
+}
+#endif
+
+#if !CLIP_RELINK && TRIG_ENABLE
+/*----------------------------------------------------------------------------*/
+/* Return 1 if sector k of a recording with one event is loud (see one_event)*/
+/*----------------------------------------------------------------------------*/
+static uint8_t one_event_loud(uint32_t k) {
+	return k == one_event;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Tap, then trigger an event right away, on the slow card: the event's clip  */
+/* is bookmarked while the tap's is still being copied, and must be saved	  */
+/* once that one is done, as recorded up to its bookmark.  The circular		  */
+/* buffer is cut short (see PENDING_NCLIPS) and the tap taken just before the*/
+/* wrap, so the event's clip straddles it: sessions opened after the wrap	  */
+/* would pre-erase the clip's start if their hint reached it, and the copy	  */
+/* must read none of the blocks they left over.								  */
+/*----------------------------------------------------------------------------*/
+static void pending_check(const char *path) {
+	struct result r;
+	uint32_t nring, tap, mark, event, offset, j, left_reads;
+
+	setup(path, &profiles[1], 50);
+	if (scan_fat(data, &info) || scan_dir(data, &info) ||
+		circ_open(data, &info, &circ)) fail("mount");
+	memset(&r, 0, sizeof(r));
+	lossless = 1;
+
+	nring = PENDING_NCLIPS * circ.cliplength / 512;
+	circ.end = circ.begin + nring * 512UL;
+	tap = nring - TRIG_POST / 2 - 2;
+	one_event = tap + 1;
+	mark = one_event + TRIG_POST + 1;
+	loud = one_event_loud;
+	left_reads = sd_emu_stats.left_reads;
+	recording(&r, mark + 2 * TRIG_POST, tap, HOLD_GATE);
+	loud = 0;
+	if (nclips != 2 || naborts != 0 || nwaiting == 0 || clip_at[1] < mark)
+		fail("pending trigger");
+	if (sd_emu_stats.left_reads != left_reads) fail("pending clip pre-erased");
+
+/* The event's clip: the sectors recorded before its bookmark, the event
+TRIG_POST + 1 blocks from its end */
+	event = circ.cliplength / 512 - TRIG_POST - 1;
+	offset = get_cluster_offset(clip_first[1], &info) + 512;
+	for (j = 0; j < circ.cliplength / 512; j++, offset += 512) {
+		if (read_block(data, offset)) fail("read_block");
+		if (read_block(data + 512, circ.begin +
+			(mark - circ.cliplength / 512 + j) % nring * 512UL))
+			fail("read_block");
+		if (memcmp(data, data + 512, 512)) fail("pending clip audio");
+/* Silence up to the event (ADPCM may take a few blocks to settle after it) */
+		capt_silence(data + 512);
+		if (j <= event && !memcmp(data, data + 512, 512) != (j != event))
+			fail("pending clip event");
+	}
+	printf("pending trigger: event's clip waited %u sectors for the tap's to "
+		"be saved\n\n", nwaiting);
+	sd_emu_close();
+}
+#endif
+
+#if CIRC_GATE && TRIG_ENABLE
+/*----------------------------------------------------------------------------*/
+/* Return 1 if sector k of combined_check()'s recording is voiced			  */
+/*----------------------------------------------------------------------------*/
+static uint8_t combined_voiced(uint32_t k) {
+	return k < one_event || (k - one_event) % COMBINED_PERIOD < COMBINED_SPEECH;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Record speech, an event and then speech with pauses, with both detectors	  */
+/* deciding, on a card slow to end its sessions (see SLUGGISH_STOP_US)		  */
+/* The gate must leave out the pauses while the event's clip is copied in the*/
+/* background.  The copy falls behind until the silence map no longer covers  */
+/* it (see clip_overrun()): the clip must be given up, with its clusters	  */
+/* freed, and recording go on with no sector lost.							  */
+/*----------------------------------------------------------------------------*/
+static void combined_check(const char *path) {
+	struct sd_emu_model sluggish = profiles[0];
+	struct result r;
+	uint32_t mark, nblocks, i, nwritten, ngated = 0;
+	uint16_t nfree, filenum;
+
+	setup(path, &profiles[0], 50);
+	if (scan_fat(data, &info) || scan_dir(data, &info) ||
+		circ_open(data, &info, &circ)) fail("mount");
+	sluggish.name = "sluggish";
+	sluggish.stop_us = SLUGGISH_STOP_US;
+	sd_emu_set_model(&sluggish);
+	memset(&r, 0, sizeof(r));
+	lossless = 1;
+	nfree = info.nfreeclusts;
+	filenum = info.nextfilenum;
+
+/* The clip is all speech, up to the bookmark; the recording goes on for a
+silence map's worth of blocks past it */
+	one_event = circ.cliplength / 512;
+	mark = one_event + TRIG_POST + 1;
+	nblocks = mark + CIRC_NMAP + COMBINED_PERIOD;
+	loud = one_event_loud;
+	voiced = combined_voiced;
+	recording(&r, nblocks, NO_TAP, 0);
+	nwritten = gate_check();
+	loud = 0;
+	voiced = 0;
+
+/* The pauses left out while the clip was being copied, until the recorder
+was CIRC_NMAP blocks ahead of the copy (it never wrapped around) */
+	for (i = clip_at[0]; i < abort_at && i < GATED_SECTS; i++) {
+		ngated += !gated_kept[i];
+	}
+	if (nclips != 1 || clip_at[0] - mark >= CAPT_NSLOTS || naborts != 1 ||
+		ngated == 0 || abort_at < mark - circ.cliplength / 512 + CIRC_NMAP ||
+		abort_at + 1 >= nblocks || info.nfreeclusts != nfree)
+		fail("combined recording");
+
+/* The FAT and the directory on the card as before the clip */
+	if (scan_fat(data, &info) || scan_dir(data, &info)) fail("mount");
+	if (info.nfreeclusts != nfree || info.nextfilenum != filenum)
+		fail("combined recording cleanup");
+	printf("combined: %u of the first %u sectors written, %u of the pauses' "
+		"left out while the event's clip was copied, given up %u sectors "
+		"after its bookmark, recording went on for %u more (%u sectors "
+		"lost)\n\n", nwritten, GATED_SECTS, ngated, abort_at - mark,
+		nblocks - abort_at - 1, capt_stats.ndropped);
+	sd_emu_close();
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* MCU cycles and bus time for one block through each SPI primitive			  */
+/*----------------------------------------------------------------------------*/
+static void spi_cycles(const struct sd_emu_model *m) {
+	uint64_t c, t;
+	int i;
+
+	printf("SPI block transfer (512 bytes, USCI cycle model)\n");
+	printf("  %-18s %9s %9s\n", "primitive", "cycles", "us");
+
+	sd_emu_set_model(m);
+	spi_config();
+
+#define MEASURE(name, code) \
+	c = spi_host_cycles; t = sd_emu_stats.time_ns; \
+	code; \
+	printf("  %-18s %9llu %9.1f\n", name, \
+		(unsigned long long)(spi_host_cycles - c), \
+		(sd_emu_stats.time_ns - t) / 1e3);
+
+	MEASURE("spia_send x 512", for (i = 0; i < 512; i++) spia_send(data[i]))
+	MEASURE("spia_send_burst", spia_send_burst(data, 512))
+	MEASURE("spia_rec x 512", for (i = 0; i < 512; i++) data[i] = spia_rec())
+	MEASURE("spia_rec_burst", spia_rec_burst(data, 512))
+	MEASURE("DMA send", spia_dma_start(data, 0, 512); spia_dma_wait())
+	MEASURE("DMA receive", spia_dma_start(0, data, 512); spia_dma_wait())
+#undef MEASURE
+
+/* DMA state machine: running until looked at twice, then idle */
+	spia_dma_start(data, 0, 512);
+	if (!spia_dma_busy() || spia_dma_busy() || spia_dma_busy()) {
+		fail("DMA busy state");
+	}
+	spia_dma_start(0, data, 512);
+	spia_dma_wait();
+	if (spia_dma_busy() || spi_host_dma_errors) fail("DMA wait state");
+
+	printf("\n");
+}
+
+#if CAPT_MULAW
+/*----------------------------------------------------------------------------*/
+/* G.711 reference encoder (Sun Microsystems' public domain g711.c): 16-bit	  */
+/* linear sample to mu-law code												  */
+/*----------------------------------------------------------------------------*/
+static uint8_t ref_linear2ulaw(int pcm) {
+	static const int seg_uend[8] =
+		{ 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF };
+	int mask, seg;
+
+	pcm >>= 2;
+	if (pcm < 0) {
+		pcm = -pcm;
+		mask = 0x7F;
+	} else {
+		mask = 0xFF;
+	}
+	if (pcm > 8159) pcm = 8159;
+	pcm += 0x84 >> 2;
+	for (seg = 0; seg < 8 && pcm > seg_uend[seg]; seg++);
+	if (seg >= 8) return (uint8_t)(0x7F ^ mask);
+	return (uint8_t)(((seg << 4) | ((pcm >> (seg + 1)) & 0x0F)) ^ mask);
+}
+
+/*----------------------------------------------------------------------------*/
+/* G.711 reference decoder (same source): mu-law code to 16-bit linear		  */
+/*----------------------------------------------------------------------------*/
+static int ref_ulaw2linear(uint8_t u) {
+	int t;
+
+	u = ~u;
+	t = ((u & 0x0F) << 3) + 0x84;
+	t <<= (u & 0x70) >> 4;
+	return (u & 0x80) ? 0x84 - t : t - 0x84;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Check the compile-time mu-law table against the reference codec: each	  */
+/* conversion must get the reference code, and decode within half a step of	  */
+/* itself unless it is beyond the largest level (clipped)					  */
+/*----------------------------------------------------------------------------*/
+static void mulaw_table_check(void) {
+	uint8_t used[256];
+	int n, x, y, step, nused = 0;
+
+	memset(used, 0, sizeof(used));
+	for (n = 0; n < 1024; n++) {
+		x = (n - 512) * 64;
+		if (capt_mulaw[n] != ref_linear2ulaw(x)) fail("mu-law table");
+		y = ref_ulaw2linear(capt_mulaw[n]);
+		step = 8 << ((~capt_mulaw[n] & 0x70) >> 4);
+		if (2 * abs(y - x) > step && abs(y) != 32124) fail("mu-law round trip");
+		if (!used[capt_mulaw[n]]++) nused++;
+	}
+	printf("mu-law table: 1024 conversions coded as the reference encoder does, "
+		"decoded within half a step\n  (%d of 256 codes used)\n\n", nused);
+}
+#endif
+
+#if CAPT_ENCODE
+/*----------------------------------------------------------------------------*/
+/* Tones through the capture encoder (capt_put_adc()) and back through the	  */
+/* decoder: signal-to-noise ratio against the 10-bit conversions, next to	  */
+/* that of the 8-bit conversions stored as PCM otherwise					  */
+/*----------------------------------------------------------------------------*/
+static void codec_round_trip(void) {
+	static const struct { double hz, amp; } tones[] = {
+		{ 300, 0.5 }, { 1000, 0.5 }, { 3000, 0.25 }, { 1000, 0.02 }
+	};
+	uint16_t in[CAPT_SLOT_SAMPLES];	// Conversions of the block being filled
+#if CAPT_ADPCM
+	struct adpcmstate st;
+#endif
+	uint8_t *block;
+	double x, y, sig, ncodec, npcm;
+	uint32_t n, j;
+	unsigned t;
+
+#if CAPT_ADPCM
+	printf("IMA ADPCM round trip (%u samples per %u-byte block)\n",
+		CAPT_SLOT_SAMPLES, CAPT_SLOT_SIZE);
+	printf("  %-18s %9s %9s\n", "tone", "ADPCM dB", "PCM8 dB");
+#else
+	printf("mu-law round trip (reference decoder)\n");
+	printf("  %-18s %9s %9s\n", "tone", "mu-law dB", "PCM8 dB");
+#endif
+	for (t = 0; t < sizeof(tones) / sizeof(tones[0]); t++) {
+		capt_reset();
+		sig = ncodec = npcm = 0;
+		for (n = 0; n < 8 * CAPT_SLOT_SAMPLES; n++) {
+			in[n % CAPT_SLOT_SAMPLES] = (uint16_t)(512.5 + 511 * tones[t].amp *
+				sin(2 * M_PI * tones[t].hz * n / capt_profile.nsamplerate));
+			if (!capt_put_adc(in[n % CAPT_SLOT_SAMPLES])) continue;
+
+/* A block is full: decode it and compare, in 10-bit units */
+			block = capt_peek();
+#if CAPT_ADPCM
+			st.predictor = (int16_t)(block[0] | block[1] << 8);
+			st.index = block[2];
+#endif
+			for (j = 0; j < CAPT_SLOT_SAMPLES; j++) {
+				x = in[j] - 512.0;
+				sig += x * x;
+#if CAPT_ADPCM
+				if (j > 0) {
+					adpcm_decode(&st, block[ADPCM_HEADER_SIZE + (j - 1) / 2] >>
+						((j - 1) % 2 ? 4 : 0) & 0x0F);
+				}
+				y = st.predictor / 64.0;
+#else
+				y = ref_ulaw2linear(block[j]) / 64.0;
+#endif
+				ncodec += (y - x) * (y - x);
+				npcm += ((in[j] >> 2) * 4 + 1.5 - in[j]) *
+					((in[j] >> 2) * 4 + 1.5 - in[j]);
+			}
+			capt_pop();
+		}
+		printf("  %4.0f Hz, %5.1f dBFS %9.1f %9.1f\n", tones[t].hz,
+			20 * log10(tones[t].amp), 10 * log10(sig / ncodec),
+			10 * log10(sig / npcm));
+	}
+	printf("\n");
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/* Stand-in for the RTC interrupt (RTC_ISR in main.c) on one tick, if the	  */
+/* tick runs																  */
+/* Return the button event posted, or BTN_NONE.								  */
+/*----------------------------------------------------------------------------*/
+static uint8_t rtc_isr(void) {
+	uint8_t ev;
+
+	if (!host_tick) return BTN_NONE;
+	ev = btn_tick();
+	led_tick();
+	if (btn_idle() && !led_busy()) rtc_tick_stop();
+	return ev;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Play a press script on the button state machine: each step holds CTRL	  */
+/* at a level for a number of ticks, the rising edges going through the Port  */
+/* 1 interrupt while it is enabled.  The events must come at the expected	  */
+/* ticks (counted from the first press), and the machine must end up idle	  */
+/* with the edge interrupt armed and the tick stopped.						  */
+/*----------------------------------------------------------------------------*/
+struct btnstep { uint8_t level; uint16_t nticks; };
+struct btnevent { uint8_t ev; uint16_t tick; };
+
+static void button_script(const char *name, const struct btnstep *steps,
+						const struct btnevent *expect) {
+	uint16_t t = 0;
+	uint8_t ev;
+
+	btn_reset();
+	host_ctrl = 0;
+	host_ctrl_int = 1;
+	host_tick = 0;
+	for (; steps->nticks; steps++) {
+		if (steps->level && !host_ctrl && host_ctrl_int) {
+			host_ctrl = 1;
+			btn_press();			// PORT1_ISR
+		}
+		host_ctrl = steps->level;
+		for (uint16_t n = 0; n < steps->nticks; n++) {
+			t++;
+			if ((ev = rtc_isr()) == BTN_NONE) continue;
+			if (ev != expect->ev || t != expect->tick || btn_take() != ev) {
+				fprintf(stderr, "button %s: event %u at tick %u\n", name, ev, t);
+				fail("button events");
+			}
+			expect++;
+		}
+	}
+	if (expect->ev != BTN_NONE) {
+		fprintf(stderr, "button %s: no event %u\n", name, expect->ev);
+		fail("button events");
+	}
+	if (!btn_idle() || !host_ctrl_int || host_tick || btn_take() != BTN_NONE)
+		fail("button idle");
+}
+
+/*----------------------------------------------------------------------------*/
+/* Check the CTRL button state machine's transitions (see button.c)			  */
+/*----------------------------------------------------------------------------*/
+static void button_check(void) {
+	const struct btnstep tap[] = { {1, 20}, {0, 10}, {0, 0} };
+	const struct btnevent tap_ev[] = { {BTN_TAP, 21}, {BTN_NONE, 0} };
+// Released before the bounce is over: noise
+	const struct btnstep noise[] = { {1, 2}, {0, 10}, {0, 0} };
+	const struct btnevent noise_ev[] = { {BTN_NONE, 0} };
+// Bouncing contacts: the level is not sampled until BTN_DEBOUNCE
+	const struct btnstep bounce[] = {
+		{1, 1}, {0, 1}, {1, 30}, {0, 10}, {0, 0} };
+	const struct btnevent bounce_ev[] = { {BTN_TAP, 33}, {BTN_NONE, 0} };
+	const struct btnstep hold[] = { {1, BTN_HOLD_TICKS + 40}, {0, 10}, {0, 0} };
+	const struct btnevent hold_ev[] = {
+		{BTN_HOLD, BTN_HOLD_TICKS}, {BTN_NONE, 0} };
+// Pressed again while the release settles: timed from the end of the settling
+	const struct btnstep again[] = {
+		{1, 20}, {0, 1}, {1, 20}, {0, 10}, {0, 0} };
+	const struct btnevent again_ev[] = {
+		{BTN_TAP, 21}, {BTN_TAP, 42}, {BTN_NONE, 0} };
+
+	button_script("tap", tap, tap_ev);
+	button_script("noise", noise, noise_ev);
+	button_script("bounce", bounce, bounce_ev);
+	button_script("hold", hold, hold_ev);
+	button_script("again", again, again_ev);
+	printf("button: tap, noise, bounce, hold and press while settling give the "
+		"expected events\n\n");
+}
+
+/*----------------------------------------------------------------------------*/
+/* Check the LED sequencer (see led.c): each pattern played on the RTC tick	  */
+/* must light the LED for its expected ticks, then end with the LED off and	  */
+/* the tick stopped; led_off() must cut a pattern short						  */
+/*----------------------------------------------------------------------------*/
+static void led_check(void) {
+	static const struct {
+		const char *name;
+		uint8_t pattern;
+		uint8_t on, off, n;			// n flashes, on and off ticks each
+	} expect[] = {
+		{ "dot", LED_DOT, 5, 0, 1 },
+		{ "dash", LED_DASH, 31, 0, 1 },
+		{ "panic", LED_PANIC, 4, 4, 10 },
+		{ "low voltage", LED_LOW_VOLTAGE, 1, 12, 10 },
+	};
+	unsigned p, k, t, nticks;
+	uint8_t lit;
+
+	btn_reset();
+	host_ctrl = 0;
+	host_ctrl_int = 1;
+	for (p = 0; p < sizeof(expect) / sizeof(expect[0]); p++) {
+		host_tick = 0;
+		led_play(expect[p].pattern);
+		nticks = expect[p].n * (expect[p].on + expect[p].off);
+		for (t = 0; t < nticks; t++) {
+			k = t % (expect[p].on + expect[p].off);
+			lit = (P1OUT & BIT3) != 0;
+			if (lit != (k < expect[p].on) || !led_busy() || !host_tick) {
+				fprintf(stderr, "LED %s: %s at tick %u\n", expect[p].name,
+					lit ? "on" : "off", t);
+				fail("LED pattern");
+			}
+			rtc_isr();
+		}
+		if (led_busy() || (P1OUT & BIT3) || host_tick) {
+			fprintf(stderr, "LED %s: still playing after %u ticks\n",
+				expect[p].name, nticks);
+			fail("LED pattern end");
+		}
+	}
+
+// Cut short: the LED goes off at once and the tick stops with the next one
+	led_play(LED_PANIC);
+	rtc_isr();
+	led_off();
+	rtc_isr();
+	if (led_busy() || (P1OUT & BIT3) || host_tick) fail("led_off");
+
+	printf("LED: dot, dash, panic and low voltage patterns light the LED for "
+		"the expected ticks\n\n");
+}
+
+int main(int argc, char **argv) {
+	const char *path = "bench.img";
+	unsigned fill_percent = 50;
+	unsigned i;
+	int a = 1;
+
+	if (a + 1 < argc && strcmp(argv[a], "-f") == 0) {
+		fill_percent = atoi(argv[a + 1]);
+		a += 2;
+	}
+	if (a < argc) path = argv[a++];
+	if (a != argc || fill_percent > 90) {
+		fprintf(stderr, "usage: %s [-f fill_percent] [image]\n", argv[0]);
+		return 2;
+	}
+
+	spi_cycles(&profiles[0]);
+	button_check();
+	led_check();
+#if CAPT_MULAW
+	mulaw_table_check();
+#endif
+#if CAPT_ENCODE
+	codec_round_trip();
+#endif
+
+	for (i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+		run(path, &profiles[i], fill_percent);
+	}
+	busy_timeout(path);
+#if !CLIP_RELINK
+	overrun_check(path);
+#endif
+#if !CLIP_RELINK && TRIG_ENABLE
+	pending_check(path);
+#endif
+#if CIRC_GATE && TRIG_ENABLE
+	combined_check(path);
+#endif
+
+	remove(path);
+	return 0;
+}
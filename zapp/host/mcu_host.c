@@ -0,0 +1,74 @@
+/**
+ * Host replacement for the MCU registers and the msp430f5310_extra.c and
+ * circuit.c functions used by the storage, button and LED code.
+ *
+ * The CTRL button is host_ctrl, and the RTC tick and the button's edge
+ * interrupt are flags, so the bench can play the RTC and Port 1 interrupts.
+ */
+
+#ifndef _MSPLIB_C
+#define _MSPLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "msp430f5310_extra.h"
+#include "circuit.h"
+
+/* Port registers written by the storage code */
+volatile uint8_t P1OUT;				// LED1 (P1.3)
+volatile uint8_t P4OUT;				// SD Card CS (P4.7)
+
+uint64_t host_div_cycles;			// Cycles in library divisions (DIV32...)
+
+uint8_t host_ctrl;					// CTRL button level (1 while pressed)
+uint8_t host_ctrl_int;				// Set while the edge interrupt is enabled
+uint8_t host_tick;					// Set while the RTC tick runs
+
+/*----------------------------------------------------------------------------*/
+/* Feed the watchdog (there is none on the host)							  */
+/*----------------------------------------------------------------------------*/
+void wdt_config(void) {
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return true iff CTRL is high (button is pressed down)					  */
+/*----------------------------------------------------------------------------*/
+uint8_t ctrl_high(void) {
+	return host_ctrl;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Clear interrupt flag for CTRL button (none on the host)					  */
+/*----------------------------------------------------------------------------*/
+void clear_int_ctrl(void) {
+}
+
+/*----------------------------------------------------------------------------*/
+/* Enable interrupt for CTRL button											  */
+/*----------------------------------------------------------------------------*/
+void ctrl_int_enable(void) {
+	host_ctrl_int = 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Disable interrupt for CTRL button										  */
+/*----------------------------------------------------------------------------*/
+void ctrl_int_disable(void) {
+	host_ctrl_int = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start the RTC tick (does nothing if the tick is running)					  */
+/*----------------------------------------------------------------------------*/
+void rtc_tick_start(void) {
+	host_tick = 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stop the RTC tick														  */
+/*----------------------------------------------------------------------------*/
+void rtc_tick_stop(void) {
+	host_tick = 0;
+}
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * Host stand-in for the IAR MSP430F5310 device header.
+ *
+ * Peripheral registers are plain variables so that the storage code (sdfat.c,
+ * wave.c) compiles unchanged for Linux.  Only the registers and bits that code
+ * touches are defined here; the SPI layer itself is replaced by spi_host.c.
+ */
+
+#ifndef _MSP430F5310_HOST_H
+#define _MSP430F5310_HOST_H
+
+#include <stdint.h>
+
+#define BIT0	0x0001
+#define BIT1	0x0002
+#define BIT2	0x0004
+#define BIT3	0x0008
+#define BIT4	0x0010
+#define BIT5	0x0020
+#define BIT6	0x0040
+#define BIT7	0x0080
+
+/* Port registers (P4.7 is the SD card chip select) */
+extern volatile uint8_t P1OUT;
+extern volatile uint8_t P4OUT;
+
+/* Divisions are runtime library calls on the MSP430 (it has no divider, see
+sdfat.h): a shift-and-subtract loop of one pass per quotient bit.  Each call
+adds its cycles to host_div_cycles; a division by a constant power of two is
+a shift, and costs nothing extra */
+extern uint64_t host_div_cycles;
+#define DIV_CALL_CYC	20			// Call, return and operand moves
+#define DIV_PASS32_CYC	13			// One pass of the 32-bit loop
+#define DIV_PASS16_CYC	8			// One pass of the 16-bit loop
+#define DIV_SIGN_CYC	12			// Signs taken off and put back
+#define DIV32_CYC		(DIV_CALL_CYC + 32 * DIV_PASS32_CYC)
+#define DIV16_CYC		(DIV_CALL_CYC + 16 * DIV_PASS16_CYC)
+#define DIV_COST(b, cyc)	(host_div_cycles += __builtin_constant_p(b) && \
+	((b) & ((b) - 1)) == 0 ? 0 : (cyc))
+#define DIV32(a, b)		(DIV_COST(b, DIV32_CYC), (uint32_t)(a) / (b))
+#define MOD32(a, b)		(DIV_COST(b, DIV32_CYC), (uint32_t)(a) % (b))
+#define SDIV32(a, b)	(DIV_COST(b, DIV32_CYC + DIV_SIGN_CYC), \
+	(int32_t)(a) / (b))
+#define DIV16(a, b)		(DIV_COST(b, DIV16_CYC), (uint16_t)(a) / (b))
+#define MOD16(a, b)		(DIV_COST(b, DIV16_CYC), (uint16_t)(a) % (b))
+
+/* CTRL button level, its edge interrupt enable and the RTC tick (see
+mcu_host.c) */
+extern uint8_t host_ctrl;
+extern uint8_t host_ctrl_int;
+extern uint8_t host_tick;
+
+/* MCU cycles spent in the SPI primitives (cycle model in spi_host.c), DMA
+transfers started while one was running, and the interrupt stand-in called
+at each primitive */
+extern uint64_t spi_host_cycles;
+extern uint32_t spi_host_dma_errors;
+extern void (*spi_host_isr)(void);
+
+/* Intrinsics */
+typedef uint16_t __istate_t;
+#define __disable_interrupt()
+#define __enable_interrupt()
+#define __get_interrupt_state()		0
+#define __set_interrupt_state(s)	((void)(s))
+#define _NOP()
+
+#endif
@@ -0,0 +1,480 @@
+/**
+ * SD card emulator for host builds.
+ *
+ * The card answers CMD0/8/12/13/17/18/24/25/55/58 and ACMD23/41 the way an
+ * SD 2.0 standard capacity card does in SPI mode (byte addressing, 512-byte
+ * blocks).  Responses are queued one Ncr byte after the command, data tokens
+ * appear after the model's access time, and a busy card drives 0x00 until its
+ * programming time has elapsed on the modeled clock.  The blocks a CMD25
+ * session leaves over from its ACMD23 hint may be erased by a real card: they
+ * are tracked until written, and reading one is counted.
+ */
+
+#ifndef _SDEMU_C
+#define _SDEMU_C
+
+#define _FILE_OFFSET_BITS	64
+#define _XOPEN_SOURCE		700
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sd_emu.h"
+
+/* Card states between commands */
+#define ST_CMD			0		// Waiting for a command
+#define ST_WR_TOKEN		1		// CMD24: waiting for 'Start Block' token
+#define ST_WR_DATA		2		// CMD24: receiving block
+#define ST_MW_TOKEN		3		// CMD25: waiting for 'Start Block'/'Stop Tran'
+#define ST_MW_DATA		4		// CMD25: receiving block
+
+#define RD_NONE			0		// Not reading
+#define RD_SINGLE		1		// CMD17 block pending
+#define RD_MULTI		2		// CMD18 streaming
+
+struct sd_emu_stats sd_emu_stats;
+
+static struct {
+	int fd;						// Disk image
+	struct sd_emu_model m;		// Timing model
+	uint64_t tbyte;				// Time per byte on the bus (ns)
+	uint64_t now;				// Card clock (ns)
+	uint64_t busy_until;		// Card busy until this time
+	uint64_t ready_at;			// Next read block ready at (0: not scheduled)
+	uint8_t out[520];			// Queued output bytes
+	uint16_t outlen, outpos;
+	uint8_t cmd[6];				// Command being received
+	uint8_t cmdlen;
+	uint8_t state;
+	uint8_t reading;
+	uint8_t idle, app, init_tries;
+	uint32_t addr;				// Address of the current data block
+	uint8_t blk[514];			// Incoming data block with CRC
+	uint16_t blklen;
+	uint32_t erase_count;		// Blocks left from the ACMD23 hint
+	uint32_t nwritten;			// Blocks written since open (for GC stalls)
+// A bit per block of the image, set if the block was left over from an ACMD23
+// hint when its session stopped, and not written since: the card may have
+// erased it
+	uint8_t *left;
+	uint32_t nblocks;			// Blocks in the image
+} card = { -1 };
+
+/*----------------------------------------------------------------------------*/
+/* Set or clear the left over bits of the n blocks from offset				  */
+/*----------------------------------------------------------------------------*/
+static void left_over(uint32_t offset, uint32_t n, uint8_t set) {
+	uint32_t b = offset / 512;
+
+	if (b >= card.nblocks) return;
+	if (n > card.nblocks - b) n = card.nblocks - b;
+	for (; n && (b & 7); n--, b++) {
+		if (set) card.left[b >> 3] |= 1 << (b & 7);
+		else card.left[b >> 3] &= ~(1 << (b & 7));
+	}
+	memset(card.left + (b >> 3), set ? 0xFF : 0x00, n / 8);
+	b += n & ~7;
+	for (n &= 7; n; n--, b++) {
+		if (set) card.left[b >> 3] |= 1 << (b & 7);
+		else card.left[b >> 3] &= ~(1 << (b & 7));
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read or write one block of the image (reads past the end return zeros)	  */
+/*----------------------------------------------------------------------------*/
+static void img_read(uint8_t *data, uint32_t offset) {
+	ssize_t n = pread(card.fd, data, 512, offset);
+	if (n < 0) n = 0;
+	memset(data + n, 0, 512 - n);
+	sd_emu_stats.blocks_read++;
+	if (offset / 512 < card.nblocks &&
+		card.left[offset / 512 >> 3] & 1 << (offset / 512 & 7))
+		sd_emu_stats.left_reads++;
+}
+
+static void img_write(const uint8_t *data, uint32_t offset) {
+	if (pwrite(card.fd, data, 512, offset) != 512) return;
+	sd_emu_stats.blocks_written++;
+	left_over(offset, 1, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Queue a response byte													  */
+/*----------------------------------------------------------------------------*/
+static void put(uint8_t b) {
+	if (card.outpos == card.outlen) card.outpos = card.outlen = 0;
+	card.out[card.outlen++] = b;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start a busy period of us microseconds, plus a GC stall when one is due	  */
+/*----------------------------------------------------------------------------*/
+static void program_block(uint32_t us) {
+	card.nwritten++;
+	if (card.m.gc_period && card.nwritten % card.m.gc_period == 0) {
+		us += card.m.gc_us;
+	}
+	card.busy_until = card.now + (uint64_t)us * 1000;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Execute a complete command frame											  */
+/*----------------------------------------------------------------------------*/
+static void do_cmd(void) {
+	uint8_t cmd = card.cmd[0] & 0x3F;
+	uint32_t arg = ((uint32_t)card.cmd[1] << 24) | ((uint32_t)card.cmd[2] << 16) |
+		((uint32_t)card.cmd[3] << 8) | card.cmd[4];
+	uint8_t app = card.app;
+	uint8_t r1;
+
+	sd_emu_stats.cmds++;
+	if (app) sd_emu_stats.acmd[cmd]++;
+	else sd_emu_stats.cmd[cmd]++;
+	card.app = 0;
+
+// Drop whatever was still being streamed
+	card.outpos = card.outlen = 0;
+
+	if (cmd == 12) {			// STOP_TRANSMISSION
+		card.reading = RD_NONE;
+		put(0xFF);				// Stuff byte
+		put(0x00);
+		card.busy_until = card.now + (uint64_t)card.m.stop_us * 1000;
+		return;
+	}
+
+	r1 = card.idle ? 0x01 : 0x00;
+	put(0xFF);					// Ncr
+
+	if (app) {
+		switch (cmd) {
+		case 41:				// SD_SEND_OP_COND
+			if (++card.init_tries >= 3) card.idle = 0;
+			put(card.idle ? 0x01 : 0x00);
+			return;
+		case 23:				// SET_WR_BLK_ERASE_COUNT
+			card.erase_count = arg & 0x7FFFFF;
+			put(r1);
+			return;
+		}
+		put(r1 | 0x04);			// Illegal command
+		return;
+	}
+
+	switch (cmd) {
+	case 0:						// GO_IDLE_STATE
+		card.idle = 1;
+		card.init_tries = 0;
+		card.reading = RD_NONE;
+		card.state = ST_CMD;
+		put(0x01);
+		return;
+	case 8:						// SEND_IF_COND
+		put(r1);
+		put(0x00);
+		put(0x00);
+		put((arg >> 8) & 0x0F);
+		put(arg);
+		return;
+	case 55:					// APP_CMD
+		card.app = 1;
+		put(r1);
+		return;
+	case 58:					// READ_OCR (standard capacity)
+		put(r1);
+		put(card.idle ? 0x00 : 0x80);
+		put(0xFF);
+		put(0x80);
+		put(0x00);
+		return;
+	}
+
+	if (card.idle) {			// Data commands need an initialized card
+		put(r1 | 0x04);
+		return;
+	}
+
+	switch (cmd) {
+	case 13:					// SEND_STATUS
+		put(r1);
+		put(0x00);
+		return;
+	case 17:					// READ_SINGLE_BLOCK
+	case 18:					// READ_MULTIPLE_BLOCK
+		if (arg % 512) {		// Address error
+			put(r1 | 0x20);
+			return;
+		}
+		put(r1);
+		card.addr = arg;
+		card.reading = (cmd == 17) ? RD_SINGLE : RD_MULTI;
+		card.ready_at = 0;
+		return;
+	case 24:					// WRITE_BLOCK
+	case 25:					// WRITE_MULTIPLE_BLOCK
+		if (arg % 512) {
+			put(r1 | 0x20);
+			return;
+		}
+		put(r1);
+		card.addr = arg;
+		card.state = (cmd == 24) ? ST_WR_TOKEN : ST_MW_TOKEN;
+		if (cmd == 24) card.erase_count = 0;
+		return;
+	}
+
+	put(r1 | 0x04);				// Illegal command
+}
+
+/*----------------------------------------------------------------------------*/
+/* Take one byte from the host												  */
+/*----------------------------------------------------------------------------*/
+static void take(uint8_t in) {
+	switch (card.state) {
+	case ST_CMD:
+		if (card.cmdlen == 0 && (in & 0xC0) != 0x40) return;
+		card.cmd[card.cmdlen++] = in;
+		if (card.cmdlen == 6) {
+			card.cmdlen = 0;
+			do_cmd();
+		}
+		return;
+
+	case ST_WR_TOKEN:
+	case ST_MW_TOKEN:
+		if (in == 0xFE && card.state == ST_WR_TOKEN) {
+			card.state = ST_WR_DATA;
+			card.blklen = 0;
+		} else if (in == 0xFC && card.state == ST_MW_TOKEN) {
+			card.state = ST_MW_DATA;
+			card.blklen = 0;
+		} else if (in == 0xFD && card.state == ST_MW_TOKEN) {
+			put(0xFF);			// One byte before the busy signal
+			card.busy_until = card.now + (uint64_t)card.m.stop_us * 1000;
+			left_over(card.addr, card.erase_count, 1);
+			card.erase_count = 0;
+			card.state = ST_CMD;
+		}
+		return;
+
+	case ST_WR_DATA:
+	case ST_MW_DATA:
+		card.blk[card.blklen++] = in;
+		if (card.blklen < sizeof(card.blk)) return;
+		img_write(card.blk, card.addr);
+		put(0xE5);				// Data accepted
+		if (card.state == ST_WR_DATA) {
+			program_block(card.m.prog_us);
+			card.state = ST_CMD;
+		} else {
+			if (card.erase_count) {
+				card.erase_count--;
+				program_block(card.m.erased_prog_us);
+			} else {
+				program_block(card.m.multi_prog_us);
+			}
+			card.addr += 512;
+			card.state = ST_MW_TOKEN;
+		}
+		return;
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Clock one byte in each direction.  selected is the state of CS (1: low).	  */
+/*----------------------------------------------------------------------------*/
+uint8_t sd_emu_xfer(uint8_t in, uint8_t selected) {
+	uint8_t out;
+
+	card.now += card.tbyte;
+	sd_emu_stats.bytes++;
+	sd_emu_stats.time_ns += card.tbyte;
+
+	if (!selected) {
+		card.cmdlen = 0;
+		return 0xFF;
+	}
+
+	if (card.outpos < card.outlen) {
+		out = card.out[card.outpos++];
+	} else if (card.now < card.busy_until) {
+		sd_emu_stats.busy_polls++;
+		return 0x00;			// Busy: input is ignored
+	} else if (card.reading) {
+		if (card.ready_at == 0) {
+			card.ready_at = card.now + (uint64_t)card.m.read_us * 1000;
+		}
+		if (card.now < card.ready_at) {
+			sd_emu_stats.wait_polls++;
+			out = 0xFF;
+		} else {
+/* Queue the block after the start token that is sent now */
+			card.outpos = card.outlen = 0;
+			img_read(card.out, card.addr);
+			card.outlen = 514;	// Data and CRC
+			card.out[512] = card.out[513] = 0xFF;
+			card.addr += 512;
+			card.ready_at = 0;
+			if (card.reading == RD_SINGLE) card.reading = RD_NONE;
+			out = 0xFE;
+		}
+	} else {
+		out = 0xFF;
+	}
+
+	take(in);
+
+	return out;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Let time pass with the bus idle (MCU work between bytes)					  */
+/*----------------------------------------------------------------------------*/
+void sd_emu_idle(uint32_t ns) {
+	card.now += ns;
+	sd_emu_stats.time_ns += ns;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Open the image file as the card in the slot								  */
+/*----------------------------------------------------------------------------*/
+int sd_emu_open(const char *path, const struct sd_emu_model *model) {
+	struct stat st;
+
+	sd_emu_close();
+	card.fd = open(path, O_RDWR);
+	if (card.fd < 0) return -1;
+	if (fstat(card.fd, &st)) {
+		sd_emu_close();
+		return -1;
+	}
+	card.nblocks = (uint32_t)(st.st_size / 512);
+	card.left = calloc(card.nblocks / 8 + 1, 1);
+	if (card.left == 0) {
+		sd_emu_close();
+		return -1;
+	}
+	card.now = card.busy_until = card.ready_at = 0;
+	card.outlen = card.outpos = 0;
+	card.cmdlen = 0;
+	card.state = ST_CMD;
+	card.reading = RD_NONE;
+	card.idle = 1;
+	card.app = 0;
+	card.erase_count = 0;
+	card.nwritten = 0;
+	sd_emu_set_model(model);
+	sd_emu_reset_stats();
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Remove the card															  */
+/*----------------------------------------------------------------------------*/
+void sd_emu_close(void) {
+	if (card.fd >= 0) close(card.fd);
+	card.fd = -1;
+	free(card.left);
+	card.left = 0;
+	card.nblocks = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Change the card's timing model											  */
+/*----------------------------------------------------------------------------*/
+void sd_emu_set_model(const struct sd_emu_model *model) {
+	card.m = *model;
+	card.tbyte = 8000000000ULL / model->spi_hz;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Clear the bus activity counters											  */
+/*----------------------------------------------------------------------------*/
+void sd_emu_reset_stats(void) {
+	memset(&sd_emu_stats, 0, sizeof(sd_emu_stats));
+}
+
+/*----------------------------------------------------------------------------*/
+/* Create a blank FAT16 image of nsects sectors (sparse file)				  */
+/* Return 0 on success.														  */
+/*----------------------------------------------------------------------------*/
+int sd_emu_mkfs(const char *path, uint32_t nsects, uint8_t nsectsinclust) {
+	const uint16_t nressects = 1;
+	const uint16_t nrootents = 512;
+	const uint32_t nrootsects = nrootents * 32 / 512;
+	uint8_t data[512];
+	uint32_t nclusts, nsectsinfat = 1;
+	int fd, i;
+
+/* Size the FAT for the clusters that remain after it */
+	for (i = 0; i < 3; i++) {
+		nclusts = (nsects - nressects - 2 * nsectsinfat - nrootsects) /
+			nsectsinclust;
+		nsectsinfat = ((nclusts + 2) * 2 + 511) / 512;
+	}
+	if (nclusts < 4085 || nclusts >= 65525) return -1;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) return -1;
+	if (ftruncate(fd, (off_t)nsects * 512)) {
+		close(fd);
+		return -1;
+	}
+
+/* Boot sector */
+	memset(data, 0, sizeof(data));
+	memcpy(data, "\xEB\x3C\x90MSDOS5.0", 11);
+	data[0x0B] = 0x00;			// Bytes per sector: 512
+	data[0x0C] = 0x02;
+	data[0x0D] = nsectsinclust;
+	data[0x0E] = (uint8_t)nressects;
+	data[0x0F] = (uint8_t)(nressects >> 8);
+	data[0x10] = 2;				// Number of FATs
+	data[0x11] = (uint8_t)nrootents;
+	data[0x12] = (uint8_t)(nrootents >> 8);
+	if (nsects < 0x10000) {
+		data[0x13] = (uint8_t)nsects;
+		data[0x14] = (uint8_t)(nsects >> 8);
+	}
+	data[0x15] = 0xF8;			// Media descriptor: fixed disk
+	data[0x16] = (uint8_t)nsectsinfat;
+	data[0x17] = (uint8_t)(nsectsinfat >> 8);
+	data[0x18] = 63;			// Sectors per track
+	data[0x1A] = 255;			// Heads
+	if (nsects >= 0x10000) {
+		data[0x20] = (uint8_t)nsects;
+		data[0x21] = (uint8_t)(nsects >> 8);
+		data[0x22] = (uint8_t)(nsects >> 16);
+		data[0x23] = (uint8_t)(nsects >> 24);
+	}
+	data[0x24] = 0x80;			// Drive number
+	data[0x26] = 0x29;			// Extended boot signature
+	memcpy(data + 0x2B, "NO NAME    FAT16   ", 19);
+	data[0x1FE] = 0x55;
+	data[0x1FF] = 0xAA;
+	if (pwrite(fd, data, 512, 0) != 512) goto fail;
+
+/* First sector of both FATs: media descriptor and end-of-chain for the
+reserved clusters 0 and 1 (the rest of the image is already zero) */
+	memset(data, 0, sizeof(data));
+	data[0] = 0xF8;
+	data[1] = 0xFF;
+	data[2] = 0xFF;
+	data[3] = 0xFF;
+	if (pwrite(fd, data, 512, (off_t)nressects * 512) != 512) goto fail;
+	if (pwrite(fd, data, 512, (off_t)(nressects + nsectsinfat) * 512) != 512)
+		goto fail;
+
+	close(fd);
+	return 0;
+
+fail:
+	close(fd);
+	return -1;
+}
+
+#endif
@@ -0,0 +1,53 @@
+/**
+ * SD card emulator for host builds.
+ *
+ * Emulates an SD 2.0 standard capacity card in SPI mode, backed by a disk
+ * image file.  Time is modeled rather than measured: every byte clocked over
+ * the bus advances the card's clock by one byte time, the MCU's work between
+ * bytes is added with sd_emu_idle(), and busy periods and read access latency
+ * are expressed in that clock.
+ */
+
+#ifndef _SDEMU_H
+#define _SDEMU_H
+
+#include <stdint.h>
+
+struct sd_emu_model {				// Card timing model (times in microseconds)
+	const char *name;				// Profile name for reports
+	uint32_t spi_hz;				// SPI clock frequency
+	uint32_t read_us;				// Access time before each block is read
+	uint32_t prog_us;				// Busy time after a single block write
+	uint32_t multi_prog_us;			// Busy time per block of a CMD25 session
+	uint32_t erased_prog_us;		// Same, for blocks pre-erased by ACMD23
+	uint32_t stop_us;				// Busy time after 'Stop Tran' or CMD12
+	uint32_t gc_period;				// Blocks written between GC stalls (0: none)
+	uint32_t gc_us;					// Length of a GC stall
+};
+
+struct sd_emu_stats {				// Bus activity since the last reset
+	uint64_t bytes;					// Bytes transferred over SPI
+	uint64_t time_ns;				// Modeled bus time
+	uint32_t cmds;					// Command frames issued (CMD55 included)
+	uint32_t cmd[64];				// Commands issued by index
+	uint32_t acmd[64];				// Application commands issued by index
+	uint64_t busy_polls;			// Bytes clocked while the card was busy
+	uint64_t wait_polls;			// Bytes clocked while waiting for data
+	uint32_t blocks_read;			// Blocks read from the image
+	uint32_t blocks_written;		// Blocks written to the image
+// Blocks read that a session had left over from its ACMD23 hint, and that
+// were not written since: the card may have erased them
+	uint32_t left_reads;
+};
+
+extern struct sd_emu_stats sd_emu_stats;
+
+int sd_emu_open(const char *path, const struct sd_emu_model *model);
+void sd_emu_close(void);
+void sd_emu_set_model(const struct sd_emu_model *model);
+void sd_emu_reset_stats(void);
+uint8_t sd_emu_xfer(uint8_t in, uint8_t selected);
+void sd_emu_idle(uint32_t ns);
+int sd_emu_mkfs(const char *path, uint32_t nsects, uint8_t nsectsinclust);
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * Host tool: mount a FAT16 disk image through sdfat.c and the SD card
+ * emulator, and print what the firmware sees.
+ *
+ * Usage: sdinfo [-m nsects] image
+ *     -m nsects	Create a blank FAT16 image of nsects sectors first
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "sdfat.h"
+#include "spi.h"
+#include "sd_emu.h"
+
+/* Timing model used when none is chosen: a typical class 4 card */
+static const struct sd_emu_model default_model = {
+	"default", 6000000, 200, 1500, 600, 400, 1000, 0, 0
+};
+
+int main(int argc, char **argv) {
+	uint8_t data[512];
+	struct fatstruct info;
+	uint32_t nsects = 0;
+	const char *path;
+	int i = 1;
+
+	if (argc > 2 && strcmp(argv[1], "-m") == 0) {
+		nsects = strtoul(argv[2], NULL, 0);
+		i = 3;
+	}
+	if (i != argc - 1) {
+		fprintf(stderr, "usage: %s [-m nsects] image\n", argv[0]);
+		return 2;
+	}
+	path = argv[i];
+
+	if (nsects && sd_emu_mkfs(path, nsects, 64)) {
+		fprintf(stderr, "%s: cannot create FAT16 image\n", path);
+		return 1;
+	}
+	if (sd_emu_open(path, &default_model)) {
+		perror(path);
+		return 1;
+	}
+
+	spi_config();
+	if (init_sd()) {
+		fprintf(stderr, "init_sd failed\n");
+		return 1;
+	}
+	if (read_boot_sector(data, &info)) {
+		fprintf(stderr, "read_boot_sector failed\n");
+		return 1;
+	}
+	if (parse_boot_sector(data, &info)) {
+		fprintf(stderr, "parse_boot_sector failed\n");
+		return 1;
+	}
+	if (scan_fat(data, &info)) {
+		fprintf(stderr, "scan_fat failed\n");
+		return 1;
+	}
+	if (scan_dir(data, &info)) {
+		fprintf(stderr, "scan_dir failed\n");
+		return 1;
+	}
+
+	printf("bytes per sector      %u\n", info.nbytesinsect);
+	printf("sectors per cluster   %u\n", info.nsectsinclust);
+	printf("reserved sectors      %u\n", info.nressects);
+	printf("FATs                  %u x %u sectors\n",
+		info.nfats, info.nsectsinfat);
+	printf("FAT offset            0x%08lX\n", (unsigned long)info.fatoffset);
+	printf("directory offset      0x%08lX (%lu bytes)\n",
+		(unsigned long)info.dtoffset, (unsigned long)info.dtsize);
+	printf("first cluster offset  0x%08lX\n",
+		(unsigned long)info.fileclustoffset);
+	printf("clusters              %u (%u free, next free %u)\n",
+		info.nclusts - 2, info.nfreeclusts, info.nextfree);
+	printf("next file number      %u\n", get_file_num(&info));
+	printf("first free entry      %lu\n",
+		(unsigned long)(info.freeentry / 32));
+	printf("SPI bytes %llu, commands %u, modeled time %.3f ms\n",
+		(unsigned long long)sd_emu_stats.bytes, sd_emu_stats.cmds,
+		sd_emu_stats.time_ns / 1e6);
+
+	sd_emu_close();
+	return 0;
+}
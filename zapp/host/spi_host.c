@@ -0,0 +1,184 @@
+/**
+ * Host replacement for spi.c.
+ *
+ * Bytes go to the SD card emulator instead of USCI_A1.  The card sees the
+ * chip select through P4OUT, which sdfat.c drives with CS_LOW_SD() and
+ * CS_HIGH_SD() exactly as on the MCU.
+ *
+ * The MCU side is a cycle model of the USCI and of the code in spi.c, with
+ * MCLK = SMCLK = 12 MHz and the SPI clock at SMCLK / 2 as set by spi.c: a
+ * byte takes 16 cycles on the bus, and each primitive costs the cycles of its
+ * MSP430X instructions (IAR output, polling loops taken once).  A primitive
+ * moves on as soon as both the bus and the CPU are done with a byte, so a
+ * byte costs the larger of the two.  The cycles are added up in
+ * spi_host_cycles, and the time beyond the bus time goes to the emulator's
+ * clock.
+ *
+ * The DMA transfers of spi.c are stood in for by a small state machine with
+ * the same interface.  A transfer is started, then runs on the bus when the
+ * CPU next looks at it: spia_dma_busy() reports it as running once and
+ * spia_dma_wait() takes the completion interrupt.  The received bytes reach
+ * the buffer only at completion and the sent bytes are read then, so code
+ * that touches either buffer too early gets caught.  The CPU's cost is the
+ * setup, the cycles the DMA steals from it (two per byte and channel) and the
+ * interrupt.
+ *
+ * The interrupts that would come in meanwhile (the sampling ones) are stood
+ * in for by spi_host_isr, called if set at each primitive and DMA completion.
+ */
+
+#ifndef _SPILIB_C
+#define _SPILIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "spi.h"
+#include "sd_emu.h"
+
+#define MCLK_HZ			12000000ULL	// MCU clock
+#define USCI_BYTE_CYC	16			// Bus time of a byte (8 bits, SMCLK / 2)
+
+/* CPU cycles of the primitives */
+#define SEND_CYC		40		// spia_send(), spia_rec(): call, wait for TX,
+								// write, wait a byte time for RX, read, return
+#define BURST_CALL_CYC	24		// Burst call, return and last byte drain
+#define BURST_TX_CYC	13		// spia_send_burst() loop, per byte
+#define BURST_RX_CYC	31		// spia_rec_burst() loop, per byte (with the
+								// interrupt state save and restore)
+
+/* CPU cycles of a DMA transfer */
+#define DMA_START_CYC	60		// spia_dma_start(): channel setup, first byte
+#define DMA_BYTE_CYC	2		// Per transfer (each byte is one on each channel)
+#define DMA_ISR_CYC		30		// Interrupt entry, DMAIV, LPM0 exit, RETI
+
+uint64_t spi_host_cycles;			// MCU cycles spent in the primitives
+void (*spi_host_isr)(void);			// Interrupt stand-in (none if 0)
+
+/* DMA transfer state */
+volatile uint8_t spia_dma_active = 0;	// Set while a transfer is running
+uint32_t spi_host_dma_errors;			// Transfers started over running ones
+static const uint8_t *dma_tx;
+static uint8_t *dma_rx;
+static uint16_t dma_count;
+static uint8_t dma_polled;				// Set once busy has been reported
+
+/*----------------------------------------------------------------------------*/
+/* Account for cycles, of which bus_cyc were spent clocking bytes			  */
+/*----------------------------------------------------------------------------*/
+static void spend(uint32_t cyc, uint32_t bus_cyc) {
+	spi_host_cycles += cyc;
+	if (cyc > bus_cyc) {
+		sd_emu_idle((uint32_t)((cyc - bus_cyc) * 1000000000ULL / MCLK_HZ));
+	}
+	if (spi_host_isr) spi_host_isr();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set up SPI for master (MCU) and slaves									  */
+/*----------------------------------------------------------------------------*/
+void spi_config(void) {
+	P4OUT |= BIT7;					// P4.7 high (SD Card CS)
+}
+
+/*----------------------------------------------------------------------------*/
+/* Transmit byte to the emulated SD card and return received byte			  */
+/*----------------------------------------------------------------------------*/
+uint8_t spia_send(const uint8_t b) {
+	spend(SEND_CYC, USCI_BYTE_CYC);
+	return sd_emu_xfer(b, (P4OUT & BIT7) == 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Receive and return byte from the emulated SD card						  */
+/*----------------------------------------------------------------------------*/
+uint8_t spia_rec(void) {
+	spend(SEND_CYC, USCI_BYTE_CYC);
+	return sd_emu_xfer(0xFF, (P4OUT & BIT7) == 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Transmit count bytes to the emulated SD card, discarding received bytes	  */
+/*----------------------------------------------------------------------------*/
+void spia_send_burst(const uint8_t *buf, uint16_t count) {
+	uint32_t per_byte = BURST_TX_CYC > USCI_BYTE_CYC ?
+		BURST_TX_CYC : USCI_BYTE_CYC;
+
+	spend(BURST_CALL_CYC + per_byte * count, USCI_BYTE_CYC * count);
+	while (count--) {
+		sd_emu_xfer(*buf++, (P4OUT & BIT7) == 0);
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Receive count bytes from the emulated SD card into buf					  */
+/*----------------------------------------------------------------------------*/
+void spia_rec_burst(uint8_t *buf, uint16_t count) {
+	uint32_t per_byte = BURST_RX_CYC > USCI_BYTE_CYC ?
+		BURST_RX_CYC : USCI_BYTE_CYC;
+
+	spend(BURST_CALL_CYC + per_byte * count, USCI_BYTE_CYC * count);
+	while (count--) {
+		*buf++ = sd_emu_xfer(0xFF, (P4OUT & BIT7) == 0);
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start a DMA transfer of count bytes (count > 0) on the emulated bus		  */
+/* tx: bytes to send, or 0 to send 0xFF										  */
+/* rx: buffer for the received bytes, or 0 to discard them					  */
+/*----------------------------------------------------------------------------*/
+void spia_dma_start(const uint8_t *tx, uint8_t *rx, uint16_t count) {
+	if (spia_dma_active) spi_host_dma_errors++;
+	spi_host_cycles += DMA_START_CYC;
+	sd_emu_idle((uint32_t)(DMA_START_CYC * 1000000000ULL / MCLK_HZ));
+	dma_tx = tx;
+	dma_rx = rx;
+	dma_count = count;
+	dma_polled = 0;
+	spia_dma_active = 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Run the transfer on the bus and take its completion interrupt			  */
+/*----------------------------------------------------------------------------*/
+static void dma_complete(void) {
+	uint8_t b;
+	uint16_t i;
+
+	for (i = 0; i < dma_count; i++) {
+		b = sd_emu_xfer(dma_tx ? dma_tx[i] : 0xFF, (P4OUT & BIT7) == 0);
+		if (dma_rx) dma_rx[i] = b;
+	}
+	spi_host_cycles += DMA_BYTE_CYC * 2UL * dma_count + DMA_ISR_CYC;
+	spia_dma_done();
+	if (spi_host_isr) spi_host_isr();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 while a DMA transfer is running									  */
+/*----------------------------------------------------------------------------*/
+uint8_t spia_dma_busy(void) {
+	if (!spia_dma_active) return 0;
+	if (!dma_polled) {
+		dma_polled = 1;
+		return 1;
+	}
+	dma_complete();
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Wait for the DMA transfer to complete									  */
+/*----------------------------------------------------------------------------*/
+void spia_dma_wait(void) {
+	if (spia_dma_active) dma_complete();
+}
+
+/*----------------------------------------------------------------------------*/
+/* End the DMA transfer (the completion interrupt's part)					  */
+/*----------------------------------------------------------------------------*/
+void spia_dma_done(void) {
+	spia_dma_active = 0;
+}
+
+#endif
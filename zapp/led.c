@@ -0,0 +1,105 @@
+/**
+ * LED pattern sequencer.
+ *
+ * led_play() starts a pattern from the pattern table and returns at once; the
+ * steps are then played by the RTC interrupt (led_tick(), on the tick shared
+ * with BTNLIB), so flashing the LED never holds up the caller.  Starting a
+ * pattern, or setting the LED with led_on() or led_off(), cuts short the one
+ * playing.  The tick runs in LPM3, so a pattern started just before entering
+ * the off state plays to its end.
+ */
+
+#ifndef _LEDLIB_C
+#define _LEDLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "msp430f5310_extra.h"
+#include "circuit.h"
+#include "led.h"
+
+#define ON(t)			(LED_STEP_ON | (t))
+#define OFF(t)			(t)
+
+// Pattern table (the lengths mimic the delay loops this replaces, at 12 MHz)
+	const uint8_t led_dot[] = { ON(5), 0 };			// 40 ms
+	const uint8_t led_dash[] = { ON(31), 0 };		// 240 ms
+	const uint8_t led_panic[] = {					// 10 flashes in 640 ms
+		ON(4), OFF(4), ON(4), OFF(4), ON(4), OFF(4), ON(4), OFF(4),
+		ON(4), OFF(4), ON(4), OFF(4), ON(4), OFF(4), ON(4), OFF(4),
+		ON(4), OFF(4), ON(4), OFF(4), 0 };
+	const uint8_t led_low_voltage[] = {				// 10 short flashes in 1.3 s
+		ON(1), OFF(12), ON(1), OFF(12), ON(1), OFF(12), ON(1), OFF(12),
+		ON(1), OFF(12), ON(1), OFF(12), ON(1), OFF(12), ON(1), OFF(12),
+		ON(1), OFF(12), ON(1), OFF(12), 0 };
+	const uint8_t *const led_patterns[LED_NPATTERNS] = {
+		led_dot, led_dash, led_panic, led_low_voltage };
+
+	const uint8_t * volatile led_step;	// Step being played (0 if none)
+	uint8_t led_ticks;					// Ticks left in the step
+
+/*----------------------------------------------------------------------------*/
+/* Set the LED for the step at led_step, or end the pattern on a 0 step		  */
+/*----------------------------------------------------------------------------*/
+void led_apply(void) {
+	if (*led_step == 0) {
+		LED1_OFF();
+		led_step = 0;
+		return;
+	}
+	if (*led_step & LED_STEP_ON) {
+		LED1_ON();
+	} else {
+		LED1_OFF();
+	}
+	led_ticks = *led_step & LED_STEP_TICKS;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start playing a pattern (LED_DOT, ...) in the background					  */
+/*----------------------------------------------------------------------------*/
+void led_play(uint8_t pattern) {
+	__istate_t s = __get_interrupt_state();
+
+	__disable_interrupt();
+	led_step = led_patterns[pattern];
+	led_apply();
+	__set_interrupt_state(s);
+
+	rtc_tick_start();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stop the pattern playing and turn the LED on								  */
+/*----------------------------------------------------------------------------*/
+void led_on(void) {
+	led_step = 0;
+	LED1_ON();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stop the pattern playing and turn the LED off							  */
+/*----------------------------------------------------------------------------*/
+void led_off(void) {
+	led_step = 0;
+	LED1_OFF();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 while a pattern is playing										  */
+/*----------------------------------------------------------------------------*/
+uint8_t led_busy(void) {
+	return led_step != 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Advance the pattern by a tick (called by the RTC interrupt)				  */
+/*----------------------------------------------------------------------------*/
+void led_tick(void) {
+	if (led_step == 0) return;
+	if (--led_ticks) return;
+	led_step++;
+	led_apply();
+}
+
+#endif
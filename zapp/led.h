@@ -0,0 +1,26 @@
+/**
+ * LED pattern library.
+ */
+
+#ifndef _LEDLIB_H
+#define _LEDLIB_H
+
+// Patterns (index in the pattern table of LEDLIB)
+#define LED_DOT			0			// Flash the length of a dot
+#define LED_DASH		1			// Flash the length of a dash
+#define LED_PANIC		2			// Flash quickly to show "panic"
+#define LED_LOW_VOLTAGE	3			// Flash briefly to signal low voltage
+#define LED_NPATTERNS	4
+
+// Pattern steps: LED state and length in ticks of the RTC tick (1 to 127, at
+// 128 Hz, see rtc_tick_start()); a pattern ends with a 0 step (LED off)
+#define LED_STEP_ON		0x80
+#define LED_STEP_TICKS	0x7F
+
+void led_play(uint8_t pattern);
+void led_on(void);
+void led_off(void);
+uint8_t led_busy(void);
+void led_tick(void);
+
+#endif
@@ -1,166 +1,289 @@
-/**
- * Written by Tim Johns.
- *
- * The function bodies in this file are specific to the MSP430F5310 MCU.
- */
-
-#ifndef _MSPLIB_C
-#define _MSPLIB_C
-
-#include <msp430f5310.h>
-#include <stdint.h>
-#include "msp430f5310_extra.h"
-
-/*----------------------------------------------------------------------------*/
-/* Enter Low Power Mode														  */
-/*----------------------------------------------------------------------------*/
-void enter_LPM(void) {
-	__enable_interrupt();		// Ensure that interrupts are enabled
-	PMMCTL0_H = PMMPW_H;		// Open PMM (Power Management Module)
-	PMMCTL0_L |= PMMREGOFF;		// Set flag to enter LPM4.5 with LPM4 request
-	//LPM4;						// Now enter LPM4.5
-// (Device does not wake up from LPM4)
-	LPM3;						// Enter Low Power Mode 3
-	_NOP();
-}
-
-/*----------------------------------------------------------------------------*/
-/* Change from Low Power Mode to normal operation							  */
-/*----------------------------------------------------------------------------*/
-void exit_LPM(void) {
-	PMMCTL0_H = PMMPW_H;		// Open PMM
-	PM5CTL0 &= ~LOCKIO;			// Clear LOCKIO and enable ports
-	PMMCTL0_H = 0x00;			// Close PMM
-	P1IFG = 0x0000;				// Clear all pending interrupt flags
-	__disable_interrupt();		// Disable interrupts for now
-}
-
-/*----------------------------------------------------------------------------*/
-/* Configure watchdog timer (also used to feed watchdog)					  */
-/*----------------------------------------------------------------------------*/
-void wdt_config(void) {
-// Select ACLK source, clear timer, timer interval = clock / 32k (1 s at 32 kHz)
-	WDTCTL = WDTPW | WDTSSEL__ACLK | WDTCNTCL | WDTIS__32K;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Stop watchdog timer														  */
-/*----------------------------------------------------------------------------*/
-void wdt_stop(void) {
-	WDTCTL = WDTPW | WDTHOLD;		// Stop watchdog timer
-}
-
-/*----------------------------------------------------------------------------*/
-/* Set up and configure ADC (10 bit)										  */
-/*----------------------------------------------------------------------------*/
-void adc_config(void) {
-// REF Master Control, Voltage Level Select 2.5 V (VREF+), Temp.Sensor off,
-// Reference On
-	REFCTL0 = REFMSTR | REFVSEL_3 | REFTCOFF | REFON;
-	ADC10CTL0 &= ~ADC10ENC;						// Disable ADC
-	ADC10CTL0 = ADC10SHT_1 | ADC10ON;			// 8 clock cycles, ADC on
-// VR+ = VREF+ and VR- = AVSS, input channel A3
-	ADC10MCTL0 = ADC10SREF_1 | ADC10INCH_3;
-// SAMPCON sourced from sampling timer, CLK/8, SMCLK source,
-// Repeat-single-channel
-// (ADC10CLK = SMCLK / 8 = 12 MHz / 8 = 1.5 MHz)
-	ADC10CTL1 = ADC10SHP | ADC10DIV_7 | ADC10SSEL_3 | ADC10CONSEQ_2;
-	ADC10CTL2 &= ~ADC10RES;						// 8-bit resolution
-	ADC10IFG = 0x0000;							// Clear interrupt flags
-	ADC10CTL0 |= ADC10ENC | ADC10SC;			// Enable and read once
-	while (!(ADC10IFG & ADC10IFG0));			// Wait for ready flag
-}
-
-/*----------------------------------------------------------------------------*/
-/* Read and return voltage with ADC (10 bit)								  */
-/* Actual voltage = (ADC10MEM0 / 1024) * 2.5								  */
-/*----------------------------------------------------------------------------*/
-uint16_t adc_read(void) {
-	ADC10IFG = 0x0000;							// Clear interrupt flags
-	while (ADC10CTL1 & ADC10BUSY);				// Wait until ADC is not busy
-	ADC10CTL0 |= ADC10SC;						// Trigger conversion
-	//while (!(ADC10IFG & ADC10IFG0));			// Wait for ready flag
-	return ADC10MEM0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Set up and configure clock												  */
-/*----------------------------------------------------------------------------*/
-void clock_config(void) {
-// Set DCO range to 4.6 - 39.0 MHz
-	UCSCTL1 = DCORSEL1 | DCORSEL2;
-// Set DCOCLKDIV to (32768 kHz / 1) * 366 =~ 12 MHz
-// (Set DCOCLK to 24 MHz)
-	UCSCTL2 = FLLN1 | FLLN2 | FLLN3 | FLLN5 | FLLN6 | FLLN8 | FLLD0;
-// Set ACLK source = REFOCLK (32 kHz), SMCLK source = DCOCLKDIV,
-// MCLK source = DCOCLKDIV
-	UCSCTL4 = SELA__REFOCLK | SELS__DCOCLKDIV | SELM__DCOCLKDIV;
-// Set SMCLKREQEN = 0, MCLKREQEN = 0 so that SMCLK and MCLK are off during LPM3
-	UCSCTL8 &= (~BIT1 & ~BIT2);
-
-///TEST crystal
-//	UCSCTL6 &= (~BIT0);			// Set XT1OFF = 0
-//	UCSCTL6 &= (~BIT2);
-}
-
-/*----------------------------------------------------------------------------*/
-/* Restart Real-Time Clock A in calendar mode								  */
-/*----------------------------------------------------------------------------*/
-void rtc_restart(void) {
-/* Switching between counter mode and calendar mode resets the clock/counter
-registers */
-	RTCCTL01 &= ~RTCMODE;
-	RTCCTL01 = RTCMODE;			// Calendar mode
-}
-
-/*----------------------------------------------------------------------------*/
-/* Return true iff RTC time values are safe for reading (not in transition)	  */
-/*----------------------------------------------------------------------------*/
-uint8_t rtc_rdy(void) {
-	return (RTCCTL01 & RTCRDY) > 0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Enable interrupts														  */
-/*----------------------------------------------------------------------------*/
-void enable_interrupts(void) {
-	__enable_interrupt();
-}
-
-/*----------------------------------------------------------------------------*/
-/* Set up Timer0_A5															  */
-/*----------------------------------------------------------------------------*/
-void timer_config(void) {
-	TA0CCR0 = 1500;				// Count up to 1500 (12 MHz / 1500 = 8 kHz)
-	TA0CCTL0 = CCIE;			// Enable interrupt for CCR0
-// SMCLK source, f/1, count up to CCR0, Timer_A clear
-	TA0CTL = TASSEL_2 | ID_0 | MC_1 | TACLR;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Disable Timer0_A5														  */
-/*----------------------------------------------------------------------------*/
-void timer_disable(void) {
-	TA0CTL = 0x0000;
-	TA0CCTL0 = 0x0000;
-	TA0CCTL1 = 0x0000;
-	TA0CCTL2 = 0x0000;
-	TA0CCTL3 = 0x0000;
-	TA0CCTL4 = 0x0000;
-}
-
-///*----------------------------------------------------------------------------*/
-///* Enable interrupt for Timer A												  */
-///*----------------------------------------------------------------------------*/
-//void timer_int_en(void) {
-//	TA0CCTL0 = CCIE;			// Enable interrupt
-//}
-
-///*----------------------------------------------------------------------------*/
-///* Disable interrupt for Timer A											  */
-///*----------------------------------------------------------------------------*/
-//void timer_int_dis(void) {
-//	TA0CCTL0 &= (~CCIE);		// Disable interrupt
-//}
-
+/**
+ * Written by Tim Johns.
+ *
+ * The function bodies in this file are specific to the MSP430F5310 MCU.
+ */
+
+#ifndef _MSPLIB_C
+#define _MSPLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "msp430f5310_extra.h"
+#include "adpcm.h"
+#include "capture.h"
+
+/*----------------------------------------------------------------------------*/
+/* Enter Low Power Mode														  */
+/*----------------------------------------------------------------------------*/
+void enter_LPM(void) {
+	__enable_interrupt();		// Ensure that interrupts are enabled
+	PMMCTL0_H = PMMPW_H;		// Open PMM (Power Management Module)
+	PMMCTL0_L |= PMMREGOFF;		// Set flag to enter LPM4.5 with LPM4 request
+	//LPM4;						// Now enter LPM4.5
+// (Device does not wake up from LPM4)
+	LPM3;						// Enter Low Power Mode 3
+	_NOP();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Change from Low Power Mode to normal operation							  */
+/*----------------------------------------------------------------------------*/
+void exit_LPM(void) {
+	PMMCTL0_H = PMMPW_H;		// Open PMM
+	PM5CTL0 &= ~LOCKIO;			// Clear LOCKIO and enable ports
+	PMMCTL0_H = 0x00;			// Close PMM
+	P1IFG = 0x0000;				// Clear all pending interrupt flags
+	__disable_interrupt();		// Disable interrupts for now
+}
+
+/*----------------------------------------------------------------------------*/
+/* Configure watchdog timer (also used to feed watchdog)					  */
+/*----------------------------------------------------------------------------*/
+void wdt_config(void) {
+// Select ACLK source, clear timer, timer interval = clock / 32k (1 s at 32 kHz)
+	WDTCTL = WDTPW | WDTSSEL__ACLK | WDTCNTCL | WDTIS__32K;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stop watchdog timer														  */
+/*----------------------------------------------------------------------------*/
+void wdt_stop(void) {
+	WDTCTL = WDTPW | WDTHOLD;		// Stop watchdog timer
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set up and configure ADC (8 or 10 bit, as the capture profile says)		  */
+/*----------------------------------------------------------------------------*/
+void adc_config(void) {
+// REF Master Control, Voltage Level Select 2.5 V (VREF+), Temp.Sensor off,
+// Reference On
+	REFCTL0 = REFMSTR | REFVSEL_3 | REFTCOFF | REFON;
+	ADC10CTL0 &= ~ADC10ENC;						// Disable ADC
+	ADC10CTL0 = ADC10SHT_1 | ADC10ON;			// 8 clock cycles, ADC on
+// VR+ = VREF+ and VR- = AVSS, input channel A3
+	ADC10MCTL0 = ADC10SREF_1 | ADC10INCH_3;
+// SAMPCON sourced from sampling timer, CLK/8, SMCLK source,
+// Repeat-single-channel
+// (ADC10CLK = SMCLK / 8 = 12 MHz / 8 = 1.5 MHz)
+	ADC10CTL1 = ADC10SHP | ADC10DIV_7 | ADC10SSEL_3 | ADC10CONSEQ_2;
+	if (capt_profile.adcbits == 10) {
+		ADC10CTL2 |= ADC10RES;					// 10-bit resolution
+	} else {
+		ADC10CTL2 &= ~ADC10RES;					// 8-bit resolution
+	}
+#if CAPT_PCM16
+	ADC10CTL2 |= ADC10DF;						// Signed, left-aligned results
+#else
+	ADC10CTL2 &= ~ADC10DF;						// Unsigned results
+#endif
+	ADC10IFG = 0x0000;							// Clear interrupt flags
+	ADC10CTL0 |= ADC10ENC | ADC10SC;			// Enable and read once
+	while (!(ADC10IFG & ADC10IFG0));			// Wait for ready flag
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read and return voltage with ADC (10 bit)								  */
+/* Actual voltage = (ADC10MEM0 / 1024) * 2.5								  */
+/*----------------------------------------------------------------------------*/
+uint16_t adc_read(void) {
+	ADC10IFG = 0x0000;							// Clear interrupt flags
+	while (ADC10CTL1 & ADC10BUSY);				// Wait until ADC is not busy
+	ADC10CTL0 |= ADC10SC;						// Trigger conversion
+	//while (!(ADC10IFG & ADC10IFG0));			// Wait for ready flag
+	return ADC10MEM0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set up and configure clock												  */
+/*----------------------------------------------------------------------------*/
+void clock_config(void) {
+// Set DCO range to 4.6 - 39.0 MHz
+	UCSCTL1 = DCORSEL1 | DCORSEL2;
+// Set DCOCLKDIV to (32768 kHz / 1) * 366 =~ 12 MHz
+// (Set DCOCLK to 24 MHz)
+	UCSCTL2 = FLLN1 | FLLN2 | FLLN3 | FLLN5 | FLLN6 | FLLN8 | FLLD0;
+// Set ACLK source = REFOCLK (32 kHz), SMCLK source = DCOCLKDIV,
+// MCLK source = DCOCLKDIV
+	UCSCTL4 = SELA__REFOCLK | SELS__DCOCLKDIV | SELM__DCOCLKDIV;
+// Set SMCLKREQEN = 0, MCLKREQEN = 0 so that SMCLK and MCLK are off during LPM3
+	UCSCTL8 &= (~BIT1 & ~BIT2);
+
+///TEST crystal
+//	UCSCTL6 &= (~BIT0);			// Set XT1OFF = 0
+//	UCSCTL6 &= (~BIT2);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Restart Real-Time Clock A in calendar mode								  */
+/*----------------------------------------------------------------------------*/
+void rtc_restart(void) {
+/* Switching between counter mode and calendar mode resets the clock/counter
+registers */
+	RTCCTL01 &= ~RTCMODE;
+	RTCCTL01 = RTCMODE;			// Calendar mode
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return true iff RTC time values are safe for reading (not in transition)	  */
+/*----------------------------------------------------------------------------*/
+uint8_t rtc_rdy(void) {
+	return (RTCCTL01 & RTCRDY) > 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start the RTC tick: prescaler RT0PS interrupt at ACLK / 256 (128 Hz)		  */
+/* (RTC_VECTOR, RTCIV = RTC_RT0PSIFG), shared by BTNLIB and LEDLIB; does	  */
+/* nothing if the tick is running											  */
+/*----------------------------------------------------------------------------*/
+void rtc_tick_start(void) {
+	if (RTCPS0CTL & RT0PSIE) return;
+	if (!(RTCCTL01 & RTCMODE) || (RTCCTL01 & RTCHOLD)) {
+		rtc_restart();			// Run the RTC (its prescalers stop with it)
+	}
+	RTCPS0CTL = RT0IP_7 | RT0PSIE;	// Interrupt every 256 ACLK cycles
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stop the RTC tick														  */
+/*----------------------------------------------------------------------------*/
+void rtc_tick_stop(void) {
+	RTCPS0CTL &= ~(RT0PSIE | RT0PSIFG);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Enable interrupts														  */
+/*----------------------------------------------------------------------------*/
+void enable_interrupts(void) {
+	__enable_interrupt();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Set up Timer0_A5															  */
+/* With CAPT_DMA, the CCR1 output (TA0.1) rises once per period and triggers */
+/* an ADC10 conversion (see adc_dma_start()); otherwise the CCR0 interrupt	  */
+/* takes the samples.  The period is the capture profile's (capt_profile).	  */
+/*----------------------------------------------------------------------------*/
+void timer_config(void) {
+// Count up to the capture profile's sample period (the 12 MHz SMCLK divided by
+// its rate, rounded)
+	TA0CCR0 = capt_profile.period;
+#if CAPT_DMA
+	TA0CCTL0 = 0x0000;			// No interrupt
+	TA0CCR1 = capt_profile.period / 2;	// TA0.1 set halfway, reset at CCR0
+	TA0CCTL1 = OUTMOD_3;		// Set/reset
+#else
+	TA0CCTL0 = CCIE;			// Enable interrupt for CCR0
+#endif
+// SMCLK source, f/1, count up to CCR0, Timer_A clear
+	TA0CTL = TASSEL_2 | ID_0 | MC_1 | TACLR;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Disable Timer0_A5														  */
+/*----------------------------------------------------------------------------*/
+void timer_disable(void) {
+	TA0CTL = 0x0000;
+	TA0CCTL0 = 0x0000;
+	TA0CCTL1 = 0x0000;
+	TA0CCTL2 = 0x0000;
+	TA0CCTL3 = 0x0000;
+	TA0CCTL4 = 0x0000;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start capturing ADC10 conversions with DMA channel 2: into the head slot	  */
+/* of the sector ring, a sector (CAPT_SLOT_SAMPLES samples) at a time, or	  */
+/* with CAPT_ENCODE into capt_raw, CAPT_RAW_SIZE conversions at a time		  */
+/* Conversions are triggered by Timer0_A (TA0.1), so call this before		  */
+/* timer_config().  At the end of each transfer, the DMA interrupt calls	  */
+/* adc_dma_next().															  */
+/*----------------------------------------------------------------------------*/
+void adc_dma_start(void) {
+	ADC10CTL0 &= ~ADC10ENC;						// Disable ADC
+// Sample-and-hold triggered by TA0.1, otherwise as in adc_config()
+	ADC10CTL1 = ADC10SHS_1 | ADC10SHP | ADC10DIV_7 | ADC10SSEL_3 |
+		ADC10CONSEQ_2;
+
+	DMA2CTL = 0;
+	DMACTL1 = DMA_TRIG_ADC10;					// DMA2 trigger: ADC10IFG0
+	DMACTL4 = DMARMWDIS;			// No transfers inside CPU read-modify-write
+	__data16_write_addr((unsigned short)&DMA2SA,
+		(unsigned long)&ADC10MEM0);
+#if CAPT_ENCODE
+	__data16_write_addr((unsigned short)&DMA2DA,
+		(unsigned long)capt_raw_swap());
+	DMA2SZ = CAPT_RAW_SIZE;
+// Single transfers of the 10-bit results (word to word), interrupt at the end
+// of the block
+	DMA2CTL = DMADT_0 | DMASRCINCR_0 | DMADSTINCR_3 | DMAIE | DMAEN;
+#elif CAPT_PCM16
+	__data16_write_addr((unsigned short)&DMA2DA,
+		(unsigned long)capt_fill_slot());
+	DMA2SZ = CAPT_SLOT_SAMPLES;
+// Single transfers of the 16-bit results (word to word), interrupt at the end
+// of the block
+	DMA2CTL = DMADT_0 | DMASRCINCR_0 | DMADSTINCR_3 | DMAIE | DMAEN;
+#else
+	__data16_write_addr((unsigned short)&DMA2DA,
+		(unsigned long)capt_fill_slot());
+	DMA2SZ = CAPT_SLOT_SIZE;
+// Single transfers of the result's low byte (word to byte), interrupt at the
+// end of the block
+	DMA2CTL = DMADT_0 | DMASRCINCR_0 | DMADSTINCR_3 | DMADSTBYTE |
+		DMAIE | DMAEN;
+#endif
+
+	ADC10IFG = 0x0000;							// Clear interrupt flags
+	ADC10CTL0 |= ADC10ENC;						// Enable, wait for triggers
+}
+
+/*----------------------------------------------------------------------------*/
+/* Point DMA channel 2 at the next slot of the sector ring, or with			  */
+/* CAPT_ENCODE at the other half of capt_raw and then encode the half just	  */
+/* filled (called by the DMA interrupt at the end of each transfer)			  */
+/* The next conversion is a sample period away, so no sample is missed.		  */
+/* Return 1 if a full sector was handed to the writer, 0 otherwise.			  */
+/*----------------------------------------------------------------------------*/
+uint8_t adc_dma_next(void) {
+#if CAPT_ENCODE
+	__data16_write_addr((unsigned short)&DMA2DA,
+		(unsigned long)capt_raw_swap());
+	DMA2SZ = CAPT_RAW_SIZE;
+	DMA2CTL |= DMAEN;
+	return capt_raw_encode();
+#else
+	__data16_write_addr((unsigned short)&DMA2DA,
+		(unsigned long)capt_block_done());
+	DMA2SZ = CAPT_SLOT_SAMPLES;
+	DMA2CTL |= DMAEN;
+	return 1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stop capturing with DMA and return the ADC10 to software triggers		  */
+/* (adc_read())																  */
+/*----------------------------------------------------------------------------*/
+void adc_dma_stop(void) {
+	DMA2CTL = 0;
+	ADC10CTL0 &= ~ADC10ENC;						// Disable ADC
+	ADC10CTL1 = ADC10SHP | ADC10DIV_7 | ADC10SSEL_3 | ADC10CONSEQ_2;
+	ADC10CTL0 |= ADC10ENC;						// Enable
+}
+
+///*----------------------------------------------------------------------------*/
+///* Enable interrupt for Timer A												  */
+///*----------------------------------------------------------------------------*/
+//void timer_int_en(void) {
+//	TA0CCTL0 = CCIE;			// Enable interrupt
+//}
+
+///*----------------------------------------------------------------------------*/
+///* Disable interrupt for Timer A											  */
+///*----------------------------------------------------------------------------*/
+//void timer_int_dis(void) {
+//	TA0CCTL0 &= (~CCIE);		// Disable interrupt
+//}
+
 #endif
\ No newline at end of file
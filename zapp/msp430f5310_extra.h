@@ -1,26 +1,38 @@
-/**
- * Written by Tim Johns.
- */
-
-#ifndef _MSPLIB_H
-#define _MSPLIB_H
-
-/* Threshold voltage for device operation = 3.0 V */
-#define VOLTAGE_THRSHLD		0x0267
-
-void enter_LPM(void);
-void exit_LPM(void);
-void wdt_config(void);
-void wdt_stop(void);
-void adc_config(void);
-uint16_t adc_read(void);
-void clock_config(void);
-void rtc_restart(void);
-uint8_t rtc_rdy(void);
-void enable_interrupts(void);
-void timer_config(void);
-void timer_disable(void);
-//void timer_int_en(void);
-//void timer_int_dis(void);
-
+/**
+ * Written by Tim Johns.
+ */
+
+#ifndef _MSPLIB_H
+#define _MSPLIB_H
+
+/* Threshold voltage for device operation = 3.0 V */
+#define VOLTAGE_THRSHLD		0x0267
+
+// DMA trigger source of ADC10 conversions (MSP430F5310 datasheet, DMA
+// trigger assignments)
+#define DMA_TRIG_ADC10		24			// ADC10IFG0
+
+// Feed the watchdog
+#define FEED_WATCHDOG	wdt_config()
+
+void enter_LPM(void);
+void exit_LPM(void);
+void wdt_config(void);
+void wdt_stop(void);
+void adc_config(void);
+uint16_t adc_read(void);
+void adc_dma_start(void);
+uint8_t adc_dma_next(void);
+void adc_dma_stop(void);
+void clock_config(void);
+void rtc_restart(void);
+uint8_t rtc_rdy(void);
+void rtc_tick_start(void);
+void rtc_tick_stop(void);
+void enable_interrupts(void);
+void timer_config(void);
+void timer_disable(void);
+//void timer_int_en(void);
+//void timer_int_dis(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+/**
+ * G.711 mu-law companding of 10-bit conversions.
+ *
+ * MULAW_ADC_TABLE expands to the mu-law codes of the 1024 ADC10 results, in
+ * order, for an array initializer: the table is worked out by the compiler,
+ * so the sampling interrupt only looks a code up.  A conversion is taken as
+ * offset binary (512 for silence) and scaled to 16 bits, then coded as in
+ * G.711: the magnitude, clipped and biased, in one of 8 segments of 16 steps,
+ * each segment's steps twice the size of the previous one's, with the code's
+ * bits inverted.
+ */
+
+#ifndef _MULAWLIB_H
+#define _MULAWLIB_H
+
+#define MULAW_CLIP		8158		// Largest magnitude (14 bits)
+#define MULAW_BIAS		33			// Added to the magnitude before coding
+
+// Magnitude of conversion n, scaled to 14 bits (16 bits, shifted right by 2)
+#define MULAW_MAG(n)	((n) >= 512 ? ((n) - 512) * 16L : (512 - (n)) * 16L)
+
+// Clipped and biased magnitude of conversion n
+#define MULAW_BIASED(n)	\
+	((MULAW_MAG(n) > MULAW_CLIP ? MULAW_CLIP : MULAW_MAG(n)) + MULAW_BIAS)
+
+// Segment of biased magnitude v (highest bit set, less 5)
+#define MULAW_SEG(v)	((v) > 0xFFF ? 7 : (v) > 0x7FF ? 6 : (v) > 0x3FF ? 5 : \
+						(v) > 0x1FF ? 4 : (v) > 0xFF ? 3 : (v) > 0x7F ? 2 : \
+						(v) > 0x3F ? 1 : 0)
+
+// Segment and step of biased magnitude v
+#define MULAW_CODE(v)	\
+	((MULAW_SEG(v) << 4) | (((v) >> (MULAW_SEG(v) + 1)) & 0x0F))
+
+// Mu-law code of conversion n (bits inverted, sign bit set for n >= 512)
+#define MULAW_ADC(n)	\
+	((uint8_t)(MULAW_CODE(MULAW_BIASED(n)) ^ ((n) >= 512 ? 0xFF : 0x7F)))
+
+// Codes of conversions n .. n + 1023
+#define MULAW_ADC4(n)	MULAW_ADC(n), MULAW_ADC((n) + 1), \
+						MULAW_ADC((n) + 2), MULAW_ADC((n) + 3)
+#define MULAW_ADC16(n)	MULAW_ADC4(n), MULAW_ADC4((n) + 4), \
+						MULAW_ADC4((n) + 8), MULAW_ADC4((n) + 12)
+#define MULAW_ADC64(n)	MULAW_ADC16(n), MULAW_ADC16((n) + 16), \
+						MULAW_ADC16((n) + 32), MULAW_ADC16((n) + 48)
+#define MULAW_ADC256(n)	MULAW_ADC64(n), MULAW_ADC64((n) + 64), \
+						MULAW_ADC64((n) + 128), MULAW_ADC64((n) + 192)
+#define MULAW_ADC_TABLE	MULAW_ADC256(0), MULAW_ADC256(256), \
+						MULAW_ADC256(512), MULAW_ADC256(768)
+
+#endif
@@ -0,0 +1,229 @@
+/**
+ * Recorder: the sectors of the capture ring to the circular buffer, and the
+ * clips saved from it while recording goes on.
+ *
+ * start_logging() wakes up whenever a sector fills and hands it to
+ * rec_sector(), which writes it at the next block of the circular buffer in
+ * a streaming session (one per run, see clip.c).  With CIRC_GATE, a silent
+ * sector is left out instead.  With TRIG_ENABLE, an event sets the save flag
+ * once its post-trigger window is recorded, as a button tap does, and
+ * bookmarks the clip there.  An event's clip waits while another one is
+ * being saved, so it may be begun long after its bookmark.
+ *
+ * When the ring is drained, rec_drained() closes the session and works on the
+ * clip being saved (or begins the one asked for) a few blocks at a time, with
+ * slots lent by the ring as data buffer (CAPT_LEND of them), until a sector is
+ * waiting again: the live recording has priority.  While those slots are not
+ * free in one piece, the session is kept open and the clip waits instead.
+ */
+
+#ifndef _RECLIB_C
+#define _RECLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "sdfat.h"
+#include "msp430f5310_extra.h"
+#include "clip.h"
+#include "adpcm.h"
+#include "capture.h"
+#include "vad.h"
+#include "trigger.h"
+#include "led.h"
+#include "record.h"
+
+uint8_t rec_begin(	uint8_t *data, struct fatstruct *, struct circstruct *,
+					struct recorder *);
+
+/*----------------------------------------------------------------------------*/
+/* Start recording at the beginning of the circular buffer					  */
+/*----------------------------------------------------------------------------*/
+void rec_start(struct fatstruct *info, struct circstruct *circ,
+				struct recorder *rec) {
+	rec->job.start_cluster = 0;		// No clip being saved
+	rec->offset = circ_start(info, circ);
+// The streaming write session is opened at the first sector to write
+	rec->streaming = 0;
+	rec->save = 0;
+	rec->mark = 0;
+	rec->hold = 0;
+	rec->tflash = 0;
+#if CIRC_GATE
+	vad_reset(&rec->vad);
+#endif
+#if TRIG_ENABLE
+	trig_reset(&rec->trig);
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* Record the oldest full sector of the ring (data) and hand its slot back	  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t rec_sector(	uint8_t *data, struct fatstruct *info,
+					struct circstruct *circ, struct recorder *rec) {
+	uint8_t silent = 0;				// Set if the sector is left out
+	uint8_t event = 0;				// Set if an event's clip ends with it
+
+	rec->hold = 0;					// The ring may drain again after it
+
+// The clip being saved must be copied before it is overwritten: if the
+// recording has caught up with its copy, the clip is given up
+	if (clip_overrun(circ, &rec->job, rec->offset)) {
+		if (rec->streaming && write_multiple_stop()) return 1;
+		rec->streaming = 0;
+		if (clip_abort(info, circ, &rec->job)) return 1;
+	}
+
+#if TRIG_ENABLE
+	event = trig_step(&rec->trig, capt_level());
+#endif
+
+#if CIRC_GATE
+// A silent sector is left out and marked in the silence map, and the
+// streaming session is closed until the next sector to write
+	silent = vad_silent(&rec->vad, capt_level());
+	circ_mark(circ, rec->offset, silent);
+#endif
+	if (silent) {
+		if (rec->streaming && write_multiple_stop()) return 1;
+		rec->streaming = 0;
+	} else {
+		if (!rec->streaming) {
+			if (write_multiple_start(rec->offset,
+				circ_run_blocks(info, circ, rec->offset))) return 1;
+			rec->streaming = 1;
+		}
+
+// Write oldest sector of recorded data (once the previous one is programmed)
+		if (write_wait()) return 1;
+		if (write_multiple_send(data)) return 1;
+
+		rec->tflash++;
+		if (rec->tflash == 50) {	// Flash LED every 50 block writes
+			led_play(LED_DOT);
+			rec->tflash = 0;
+		}
+	}
+	capt_pop();						// Sector done: hand slot back
+
+// Next block (within circular buffer)
+	rec->offset = circ_next(info, circ, rec->offset);
+	if (rec->offset == 0) {
+// The streaming session ends with the run, the next one starts at the next
+// run of the circular buffer
+		if (rec->streaming && write_multiple_stop()) return 1;
+		rec->streaming = 0;
+		rec->offset = circ_next_run(info, circ);
+		if (rec->offset == 0) return 1;
+	}
+
+// An event saves a clip like a tap, bookmarked here, once its post-trigger
+// window is recorded
+	if (event) {
+		rec->save = 1;
+		rec->mark = rec->offset;
+#if !CLIP_RELINK
+		circ_pend(circ, rec->mark);	// Its blocks may wait long to be copied
+#endif
+		led_play(LED_DASH);			// Signal clip save
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start saving the clip asked for, with none being saved					  */
+/* The clip ends at the event's bookmark (rec->mark), or at the offset being  */
+/* recorded if none (a tap).  In relink mode, the clip is saved at once and	  */
+/* recording goes on at the start of the circular buffer (see clip_begin()).  */
+/* The data buffer must hold one block.										  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t rec_begin(	uint8_t *data, struct fatstruct *info,
+					struct circstruct *circ, struct recorder *rec) {
+#if !CLIP_RELINK
+	uint32_t bookmark = rec->mark ? rec->mark : rec->offset;
+#endif
+
+	rec->save = 0;
+	rec->mark = 0;
+#if CLIP_RELINK
+// The clip's clusters are the ones recorded so far (the bookmark is at most a
+// few sectors behind, as no clip is ever left to wait)
+	rec->offset = clip_begin(data, info, circ, &rec->job, rec->offset);
+	return rec->offset == 0;
+#else
+	return clip_begin(data, info, circ, &rec->job, bookmark) == 0;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* Work on the clip with the ring drained, until a sector is waiting		  */
+/* The streaming session is closed, and the CAPT_LEND slots behind the ring's */
+/* tail serve as data buffer meanwhile.  If they are not free in one piece	  */
+/* (they would wrap around the end of the ring), the clip is left for the	  */
+/* next drain and the session stays open (see rec_idle()): a step of fewer	  */
+/* blocks would cost the live recording a session's round trip all the same. */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t rec_drained(struct fatstruct *info, struct circstruct *circ,
+					struct recorder *rec) {
+	uint8_t *data;					// Slots lent as data buffer
+
+	if ((data = capt_lend(CAPT_LEND)) == 0) {
+		rec->hold = 1;
+		return 0;
+	}
+	if (rec->streaming && write_multiple_stop()) return 1;
+	rec->streaming = 0;
+
+	while (rec->save || clip_busy(&rec->job)) {
+		if (!clip_busy(&rec->job)) {
+// Store the clip preceding the bookmark as a new file, as soon as the one
+// being saved is done (before any sector is written over it)
+			if (rec_begin(data, info, circ, rec)) return 1;
+		} else {
+			if (capt_peek()) break;
+			if (clip_step(data, CAPT_LEND, info, circ, &rec->job)) return 1;
+		}
+		FEED_WATCHDOG;
+	}
+
+	capt_return();
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 if the recorder has nothing to do until the next sector: no clip */
+/* to work on, or none it can work on with the ring drained (see			  */
+/* rec_drained())															  */
+/*----------------------------------------------------------------------------*/
+uint8_t rec_idle(struct recorder *rec) {
+	return rec->hold || (rec->save == 0 && !clip_busy(&rec->job));
+}
+
+/*----------------------------------------------------------------------------*/
+/* Stop recording, with sampling stopped and the ring drained				  */
+/* The streaming session is closed, and the clip being saved is finished	  */
+/* with the whole ring as data buffer, then the one asked for, if any.		  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t rec_stop(struct fatstruct *info, struct circstruct *circ,
+				struct recorder *rec) {
+	if (rec->streaming && write_multiple_stop()) return 1;
+	rec->streaming = 0;
+
+	while (rec->save || clip_busy(&rec->job)) {
+		if (!clip_busy(&rec->job)) {
+			if (rec_begin(capt_buff, info, circ, rec)) return 1;
+		} else {
+			if (clip_step(capt_buff, CAPT_NSLOTS, info, circ, &rec->job))
+				return 1;
+		}
+		FEED_WATCHDOG;
+	}
+	return 0;
+}
+
+#endif
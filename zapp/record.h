@@ -0,0 +1,35 @@
+/**
+ * Recorder library.
+ */
+
+#ifndef _RECLIB_H
+#define _RECLIB_H
+
+struct recorder {					// Recording to the circular buffer
+	struct clipjob job;				// Clip being saved
+	uint32_t offset;				// Offset of the next block to record
+	uint8_t streaming;				// Set while a streaming session is open
+	uint8_t save;					// Set to save a clip once the ring drains
+// Set while the ring is drained but the clip cannot be worked on (see
+// rec_drained()): the session stays open until the next sector
+	uint8_t hold;
+// End of the clip to save (0 to end it at the offset being recorded then)
+	uint32_t mark;
+	uint8_t tflash;					// Used for timing LED flashes
+#if CIRC_GATE
+	struct vadstate vad;			// Voice activity detector
+#endif
+#if TRIG_ENABLE
+	struct trigstate trig;			// Event trigger
+#endif
+};
+
+void rec_start(struct fatstruct *, struct circstruct *, struct recorder *);
+uint8_t rec_sector(	uint8_t *data, struct fatstruct *, struct circstruct *,
+					struct recorder *);
+uint8_t rec_drained(struct fatstruct *, struct circstruct *,
+					struct recorder *);
+uint8_t rec_idle(struct recorder *);
+uint8_t rec_stop(struct fatstruct *, struct circstruct *, struct recorder *);
+
+#endif
@@ -1,707 +1,1250 @@
-/**
- * Written by Tim Johns.
- *
- * SD card SPI interface and FAT16 implementation.
- *
- * In the current circuit design, the SD card is using the USCI_A1 SPI bus, thus
- * the functions spia_send() and spia_rec() are used.
- */
-
-/*
-* FAT16 Boot Sector
-* 
-* Field               Offset     Length
-* -----               ------     ------
-* Bytes Per Sector      11(0Bh)    2
-* Sectors Per Cluster   13(0Dh)    1
-* Reserved Sectors      14(0Eh)    2
-* FATs                  16(10h)    1
-* Root Entries          17(11h)    2
-* Small Sectors         19(13h)    2
-* Media Descriptor      21(15h)    1
-* Sectors Per FAT       22(16h)    2
-* Sectors Per Track     24(18h)    2
-* Heads                 26(1Ah)    2
-* Hidden Sectors        28(1Ch)    4
-* Large Sectors         32(20h)    4
-*/
-
-#ifndef _SDFATLIB_C
-#define _SDFATLIB_C
-
-#include <msp430f5310.h>
-#include <stdint.h>
-#include "spi.h"
-#include "circuit.h"
-#include "sdfat.h"
-
-#define ACCEL_DATA		3		// Type of number
-#define GYRO_DATA		4		// Type of number
-
-/*----------------------------------------------------------------------------*/
-/* Global variables in the scope of this file								  */
-/*----------------------------------------------------------------------------*/
-// Directory table entry (MUST BE 32 BYTES)
-	uint8_t dte[] = "DATA000 WAV\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
-		"\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00";
-
-/*----------------------------------------------------------------------------*/
-/* Initialize SD Card														  */
-/*----------------------------------------------------------------------------*/
-uint8_t init_sd(void) {
-	uint8_t short_timeout = 10;
-	uint16_t tmr, long_timeout = 0x1000;
-	uint8_t ocr[4];
-	uint8_t card_type;			// SD 1.0, 1.1, 2.0
-	uint8_t n;
-
-	CS_HIGH_SD();				// Card deselect
-
-// Must supply min of 74 clock cycles with CS high
-	for (uint8_t i = 0; i < 80; i++) spia_send(0xFF);
-	
-	CS_LOW_SD();				// Card select
-
-/* Enter SPI mode */
-	for (tmr = short_timeout; tmr && (send_cmd_sd(CMD0, 0) != 1); tmr--);
-	if (tmr == 0) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-
-/* Verify SD 2.0 and 2.7-3.6V */
-	if (send_cmd_sd(CMD8, 0x1AA) != 0x01) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-// Get response
-	for (n = 0; n < 4; n++) ocr[n] = spia_rec();
-// 2.7-3.6 V
-	if (ocr[2] != 0x01 || ocr[3] != 0xAA) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-
-/* Wait for leaving idle state (ACMD41 with HCS bit) */
-	for (tmr = long_timeout; tmr && (send_acmd_sd(ACMD41, 1UL << 30) != 0);
-		tmr--);
-	if (tmr == 0) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-
-/* Check High Capacity support (SDHC) */
-	if (send_cmd_sd(CMD58, 0)) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-// Get response
-	for (n = 0; n < 4; n++) ocr[n] = spia_rec();
-// SD 2.0 (HC or not)
-	card_type = (ocr[0] & 0x40) ?
-		CT_SD2 | CT_BLOCK : CT_SD2;
-
-	CS_HIGH_SD();				// Card deselect
-
-	if (card_type == CT_SD2) {	// SD 2.0
-		return 0;
-	}
-
-// SDHC
-	if (card_type == (CT_SD2 | CT_BLOCK)) {
-		return 0;
-	}
-
-// Fail: unrecognized card type
-	return 1;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Send command to enter idle state											  */
-/*----------------------------------------------------------------------------*/
-void go_idle_sd() {
-	CS_LOW_SD();				// Card select
-	
-	send_cmd_sd(CMD0, 0);
-
-// Note: leave CS low to refrain from consuming power
-}
-
-/*----------------------------------------------------------------------------*/
-/* Send command and return error code.  Return zero for OK					  */
-/*----------------------------------------------------------------------------*/
-uint8_t send_cmd_sd(uint8_t cmd, uint32_t arg) {
-	uint8_t status;
-	uint8_t crc;
-
-	spia_send(cmd | 0x40);		// Send command
-	
-// Send argument
-	for (int8_t s = 24; s >= 0; s -= 8) spia_send(arg >> s);
-	
-/* Send CRC */
-	crc = 0xFF;
-// correct crc for CMD0 with arg 0
-	if (cmd == CMD0) crc = 0x95;
-// correct crc for CMD8 with arg 0x1AA
-	if (cmd == CMD8) crc = 0x87;
-	spia_send(crc);
-	
-// Wait for response
-	for (uint8_t i = 0; ((status = spia_rec()) & 0x80) && i < 0xFF; i++);
-	
-	return status;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Send ACMD to SPI															  */
-/*----------------------------------------------------------------------------*/
-uint8_t send_acmd_sd(uint8_t acmd, uint32_t arg) {
-	uint8_t resp = send_cmd_sd(CMD55, 0);
-	if (resp > 1) return resp;
-	return send_cmd_sd(acmd, arg);
-}
-
-/*----------------------------------------------------------------------------*/
-/* Wait for the card														  */
-/*----------------------------------------------------------------------------*/
-void wait_notbusy(void) {
-	while (spia_rec() != 0xFF);
-}
-
-/*----------------------------------------------------------------------------*/
-/* Wait for Start Block token												  */
-/*----------------------------------------------------------------------------*/
-uint8_t wait_startblock(void) {
-	uint8_t rec;
-	for (uint16_t i = 0; i < 500; i++) {
-		rec = spia_rec();
-		if (rec == 0xFE) {		// Start Block token received
-			return 0;
-		}
-		if (rec != 0xFF) {		// Error
-			return 1;
-		}
-	}
-	return 1;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Write multiple blocks													  */
-/* Assume data buffer 2048 bytes in size and write 4 consecutive 512-byte	  */
-/* blocks, beginning at start_offset.										  */
-/*----------------------------------------------------------------------------*/
-//uint8_t write_multiple_block(uint8_t *data, uint32_t start_offset) {
-//	CS_LOW_SD();
-//
-//	wait_notbusy();				// Wait for card to be ready
-//
-//// WRITE_MULTIPLE_BLOCK command
-//	if (send_cmd_sd(CMD25, start_offset)) {
-//		CS_HIGH_SD();			// Card deselect
-//		return 1;
-//	}
-//
-///* Write data buffer to 4 blocks */
-//	uint8_t i;
-//	uint16_t j;
-//	for (i = 0; i < 4; i++) {
-//// Send 'Start Block' token for each block
-//		spia_send(START_BLK_TOK);
-//
-//		for (j = 0; j < 512; j++) {
-//			spia_send(data[j]);
-//		}
-//
-//		spia_send(0xFF); 		// Dummy CRC
-//		spia_send(0xFF); 		// Dummy CRC
-//
-//		wait_notbusy();			// Wait for flash programming to complete
-//	}
-//
-//	spia_send(STOP_TRANS_TOK);	// Send 'Stop Tran' token (stop transmission)
-//
-//// Get status
-//	if (send_cmd_sd(CMD13, 0) || spia_rec())	{
-//		CS_HIGH_SD();			// Card deselect
-//		return 1;
-//	}
-//	
-//	CS_HIGH_SD();				// Card deselect
-//
-//	return 0;
-//}
-
-/*----------------------------------------------------------------------------*/
-/* Write the first count bytes in the given data buffer starting at offset	  */
-/*----------------------------------------------------------------------------*/
-uint8_t write_block(uint8_t *data, uint32_t offset, uint16_t count) {
-	CS_LOW_SD();
-	
-// WRITE_BLOCK command
-	if (send_cmd_sd(CMD24, offset)) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-	spia_send(0xFE);			// Write Single Block token
-	
-/* Write data bytes (up to 512) */
-	if (count > 512) count = 512;
-	uint16_t i;
-	for (i = 0; i < count; i++) {
-		spia_send(data[i]);
-	}
-	
-// Padding to fill block
-	for (; i < 512; i++) spia_send(0x00);
-	
-	spia_send(0xFF); 			// Dummy CRC
-	spia_send(0xFF);			// Dummy CRC
-	
-	if ((spia_rec() & 0x1F) != 0x05) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-
-// Wait for flash programming to complete
-	wait_notbusy();
-	
-// Get status
-	if (send_cmd_sd(CMD13, 0) || spia_rec())	{
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-	
-	CS_HIGH_SD();				// Card deselect
-	
-	return 0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Read 512 bytes from offset and store them in the given data buffer		  */
-/*----------------------------------------------------------------------------*/
-uint8_t read_block(uint8_t *data, uint32_t offset) {
-	CS_LOW_SD();				// Card select
-	
-// READ_SINGLE_BLOCK command with offset as argument
-	if (send_cmd_sd(CMD17, offset)) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;
-	}
-
-	if (wait_startblock()) {
-		CS_HIGH_SD();			// Card deselect
-		return 1;				// Wait for the start of the block
-	}
-	
-/* Read bytes */
-	for (uint16_t i = 0; i < 512; i++) {
-		data[i] = spia_rec();
-	}
-	
-	CS_HIGH_SD();				// Card deselect
-	
-	return 0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Find and return a free cluster for writing file contents					  */
-/* Start searching incrementally, starting at start_cluster.				  */
-/* Return free cluster index (>0).											  */
-/* Return 0 on error or if there are no more free clusters.					  */
-/*----------------------------------------------------------------------------*/
-uint16_t find_cluster(uint8_t *data, struct fatstruct *info) {
-	uint32_t block_offset = 0;
-	uint16_t i, j;
-
-	for (i = 0; i < info->fatsize; i += 2) {
-		j = i % 512;			// Cluster index relative to block
-				
-/* Read each new block of the FAT */
-		if (j == 0) {
-			block_offset = info->fatoffset + i;
-			if (read_block(data, block_offset)) return 0;
-		}
-		
-		if (data[j] == 0x00 && data[j+1] == 0x00) {
-			
-/* Set cluster to 0xFFFF to indicate end of cluster chain for current file
-(will be modified if file data continues) */
-			data[j] = 0xFF;
-			data[j+1] = 0xFF;
-
-// Write to FAT 
-			if (write_block(data, block_offset, 512)) return 0;
-
-// Write to second FAT 
-			if (info->nfats > 1) {
-				if (write_block(data, block_offset + info->fatsize, 512)) return 0;
-			}
-
-// Return free cluster index
-			return (uint16_t)(i / 2);
-		}
-	}
-	
-// Failed to find a free cluster (disk may be full)
-	return 0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Return the offset of the given cluster number							  */
-/*----------------------------------------------------------------------------*/
-uint32_t get_cluster_offset(uint16_t clust, struct fatstruct *info) {
-	return info->fileclustoffset + ((clust - 2) * info->nbytesinclust);
-}
-
-/*----------------------------------------------------------------------------*/
-/* Return true iff block number is less than nsectsinclust					  */
-/*----------------------------------------------------------------------------*/
-uint8_t valid_block(uint8_t block, struct fatstruct *info) {
-	return block < info->nsectsinclust;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Update the FAT															  */
-/* Replace the cluster word at byte offset index with num.					  */
-/*----------------------------------------------------------------------------*/
-uint8_t update_fat(	uint8_t *data, struct fatstruct *info,
-					uint16_t index, uint16_t num) {
-	uint32_t block_offset = info->fatoffset + index - (index % 512);
-	
-// Read the right block of the FAT 
-	if (read_block(data, block_offset)) return 1;
-
-	index = index % 512;		// Change index from absolute to relative
-
-/* Point cluster word at index to num cluster */
-	data[index] = (uint8_t)num;
-	data[index+1] = (uint8_t)(num >> 8);
-
-// Write to FAT 
-	if (write_block(data, block_offset, 512)) return 1;
-
-// Write to second FAT 
-	if (info->nfats > 1) {
-		if (write_block(data, block_offset + info->fatsize, 512)) return 1;
-	}
-
-	return 0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Update directory table													  */
-/* cluster: file's starting cluster											  */
-/* file_size: total bytes in file											  */
-/* file_num: file name number suffix										  */
-/*----------------------------------------------------------------------------*/
-uint8_t update_dir_table(	uint8_t *data,
-							struct fatstruct *info,
-							uint16_t cluster,
-							uint32_t file_size,
-							uint16_t file_num) {
-/*------------------------------------------------------------------------*/
-/* Read the directory table.											  */
-/* Find the last entry and prepare the next directory table entry.		  */
-/*------------------------------------------------------------------------*/
-	uint32_t i, j;
-	for (i = 0, j = 0; i < info->dtsize; i += 32) {
-		if (i % info->nbytesinsect == 0) {
-// Next sector
-			if (read_block(data, info->dtoffset + i)) return 1;
-			if (i > 0) j++;
-		}
-		
-// Check for empty entry or deleted file (0xE5 prefix)
-		if (data[i % 512] == 0x00 || data[i % 512] == 0xE5) {
-			break;				// Found the entry offset
-		}
-	}
-// Check if directory table is full
-	if ((i + (512 * j)) >= info->dtsize) return 1;
-	
-// Offset of directory table entry
-	uint32_t dir_entry_offset = info->dtoffset + i;
-
-// Set filename prefix
-	dte[0] = 'D'; dte[1] = 'A'; dte[2] = 'T'; dte[3] = 'A';
-
-/* Set filename suffix (e.g., "012") */
-	dte[4] = ((file_num / 100) % 10) + 0x30;
-	dte[5] = ((file_num / 10) % 10) + 0x30;
-	dte[6] = (file_num % 10) + 0x30;
-
-/* Set starting cluster */
-	dte[27] = (uint8_t)(cluster >> 8);
-	dte[26] = (uint8_t)(cluster);
-
-/* Set file size */
-	dte[31] = (uint8_t)(file_size >> 24);
-	dte[30] = (uint8_t)(file_size >> 16);
-	dte[29] = (uint8_t)(file_size >> 8);
-	dte[28] = (uint8_t)(file_size);
-
-/* Update directory table with new directory table entry */
-// Recall: at this point, i = index of data at beginning of new dte
-	for (j = 0; j < 32; i++, j++) {
-		data[i] = dte[j];
-	}
-	
-/* We can only write blocks of nbytesinsect bytes, so make sure the offset
-we're writing to is at the beginning of a sector */
-	write_block(data,
-		dir_entry_offset - (dir_entry_offset % info->nbytesinsect), 512);
-	
-	return 0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Find the boot sector, read it (store in data buffer), and verify its		  */
-/* validity																	  */
-/*----------------------------------------------------------------------------*/
-uint8_t read_boot_sector(uint8_t *data, struct fatstruct *boot) {
-/* Find boot sector */
-	boot->nhidsects = 0;
-	boot->bootoffset = 0;
-// Read first sector
-	if (read_block(data, 0)) return 1;
-	
-// Check if the first sector is the boot sector
-	if (data[0x00] == 0x00) {
-// First sector is not boot sector, find location of boot sector
-// number of hidden sectors: 4 bytes at offset 0x1C6
-		boot->nhidsects = data[0x1C6] |
-						 ((uint32_t)data[0x1C7] << 8) |
-						 ((uint32_t)data[0x1C8] << 16) |
-						 ((uint32_t)data[0x1C9] << 24);
-// Location of boot sector
-		boot->bootoffset = boot->nhidsects * 512;
-// Read boot sector and store in data buffer
-		if (read_block(data, boot->bootoffset)) return 1;
-	}
-	
-// Verify validity of boot sector
-	if ((data[0x1FE] | (data[0x1FF] << 8)) != 0xAA55) return 1;
-
-	return 0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Parse the FAT16 boot sector												  */
-/*----------------------------------------------------------------------------*/
-uint8_t parse_boot_sector(uint8_t *data, struct fatstruct *info) {
-// Is the SD card formatted to FAT16?
-	if ( !(data[0x36] == 'F' &&
-		   data[0x37] == 'A' &&
-		   data[0x38] == 'T' &&
-		   data[0x39] == '1' &&
-		   data[0x3A] == '6') ) {
-		return 1;
-	}
-
-/********************************************************/
-/* Fill valuable global variables						*/
-/*														*/
-/* bytes per sector:			2 bytes	at offset 0x0B	*/
-/* sectors per cluster:			1 byte	at offset 0x0D	*/
-/* number of reserved sectors:	2 bytes	at offset 0x0E	*/
-/* number of FATs:				1 byte	at offset 0x10	*/
-/* max directory entries:		2 bytes	at offset 0x11	*/
-/* number of sectors per FAT:	2 bytes	at offset 0x16	*/
-/* total sectors:				4 bytes	at offset 0x20	*/
-/********************************************************/
-	info->nbytesinsect = data[0x0B] | (data[0x0C] << 8);
-	info->nsectsinclust = data[0x0D];
-	info->nbytesinclust = info->nbytesinsect * info->nsectsinclust;
-	info->nressects = data[0x0E] | (data[0x0F] << 8);
-	info->nfats = data[0x10];
-	info->dtsize = (data[0x11] | (data[0x12] << 8)) * 32;
-	info->nsectsinfat = data[0x16] | (data[0x17] << 8);
-	info->nsects = data[20] | ((uint32_t)data[21] << 8) |
-		((uint32_t)data[22] << 16) | ((uint32_t)data[23] << 24);
-	
-// Only compatible with sectors of 512 bytes
-	if (info->nbytesinsect != 512) return 2;
-	
-/* Get location of FAT */
-	info->fatsize = (uint32_t)info->nbytesinsect * (uint32_t)info->nsectsinfat;
-	info->fatoffset = (uint32_t)info->nressects * (uint32_t)info->nbytesinsect +
-				 info->bootoffset;
-	
-// Get location of directory table
-	info->dtoffset = (uint32_t)info->nbytesinsect *
-						(uint32_t)info->nressects +
-						512 * (uint32_t)info->nsectsinfat *
-		(uint32_t)info->nfats +
-		info->bootoffset;
-	
-// Get location of first cluster to be used by file data
-	info->fileclustoffset = info->dtoffset + info->dtsize;
-
-	return 0;
-}
-
-/*----------------------------------------------------------------------------*/
-/* Scan through directory table for highest file number suffix and return the */
-/* next highest number														  */
-/*----------------------------------------------------------------------------*/
-uint16_t get_file_num(uint8_t *data, struct fatstruct *info) {
-	uint16_t max = 0;			// Highest file number suffix
-	uint16_t tmp16, x;			// Temporary storage
-	uint32_t i, j;
-
-	i = 0;						// Directory table byte count
-	j = 0;						// Directory table entry address
-
-	do {
-// Check for end of sector
-		if (i % info->nbytesinsect == 0) {
-// Read next sector
-			if (read_block(data, info->dtoffset + i)) return 1;
-			j = 0;
-		}
-		if (data[j] != 0xE5) {	// 0xE5 marks a deleted file
-/* Convert 3 byte ASCII file number suffix to integer */
-
-// First digit
-			tmp16 = data[j+4] - 0x30;
-			if (tmp16 > 9) {
-				i += 32;		// Update byte counter
-// Address of next directory table entry
-				j = i % info->nbytesinsect;
-				continue;
-			}
-
-			x = tmp16 * 100;
-
-// Second digit
-			tmp16 = data[j+5] - 0x30;
-			if (tmp16 > 9) {
-				i += 32;		// Update byte counter
-// Address of next directory table entry
-				j = i % info->nbytesinsect;
-				continue;
-			}
-
-			x += tmp16 * 10;
-
-// Third digit
-			tmp16 = data[j+6] - 0x30;
-			if (tmp16 > 9) {
-				i += 32;		// Update byte counter
-// Address of next directory table entry
-				j = i % info->nbytesinsect;
-				continue;
-			}
-
-			x += tmp16;
-
-// Keep track of highest file number suffix
-			if (x > max) max = x;
-		}
-// Update byte counter
-		i += 32;
-// Address of next directory table entry
-		j = i % info->nbytesinsect;
-// 0x00 marks the end of directory table entries
-	} while (i < info->dtsize && data[j] != 0x00);
-
-// Return the highest usable file number suffix
-	return (max + 1);
-}
-
-/*----------------------------------------------------------------------------*/
-/* Format the SD card to FAT16 (quick format)								  */
-/*----------------------------------------------------------------------------*/
-//void format_sd(uint8_t *data) {
-//	uint16_t i;
-//	uint32_t j;
-//
-//// Set data buffer to null bytes for filling SD card sectors
-//	for (i = 0; i < 512; i++) {
-//		data[i] = 0x00;
-//	}
-//
-//// Fill with null bytes from offset 0h to 3F000h (not including 3F000h)
-//	for (j = 0; j < 0x3F000; j += 512) {
-//		write_block(data, j, 512);
-//		if (j % 2048 == 0) {
-//			LED1_TOGGLE();			// Flash LED to signal formatting
-//		}
-//	}
-//
-//	LED1_ON();
-//
-//// Initialize bytes for boot sector
-//// (temporary variable for clean initialization)
-//	uint8_t tmp[] = {
-//			0xEB, 0x3C, 0x90, 0x4D, 0x53, 0x44, 0x4F, 0x53, 0x35, 0x2E, 0x30, \
-//			0x00, 0x02, 0x40, 0x02, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0xF8, \
-//			0xEB, 0x00, 0x3F, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
-//			0xA0, 0x3A, 0x00, 0x80, 0x00, 0x29, 0xFF, 0xFF, 0xFF, 0xFF, 0x4E, \
-//			0x4F, 0x20, 0x4E, 0x41, 0x4D, 0x45, 0x20, 0x20, 0x20, 0x20, 0x46, \
-//			0x41, 0x54, 0x31, 0x36, 0x20, 0x20, 0x20, 0x33, 0xC9, 0x8E, 0xD1, \
-//			0xBC, 0xF0, 0x7B, 0x8E, 0xD9, 0xB8, 0x00, 0x20, 0x8E, 0xC0, 0xFC, \
-//			0xBD, 0x00, 0x7C, 0x38, 0x4E, 0x24, 0x7D, 0x24, 0x8B, 0xC1, 0x99, \
-//			0xE8, 0x3C, 0x01, 0x72, 0x1C, 0x83, 0xEB, 0x3A, 0x66, 0xA1, 0x1C, \
-//			0x7C, 0x26, 0x66, 0x3B, 0x07, 0x26, 0x8A, 0x57, 0xFC, 0x75, 0x06, \
-//			0x80, 0xCA, 0x02, 0x88, 0x56, 0x02, 0x80, 0xC3, 0x10, 0x73, 0xEB, \
-//			0x33, 0xC9, 0x8A, 0x46, 0x10, 0x98, 0xF7, 0x66, 0x16, 0x03, 0x46, \
-//			0x1C, 0x13, 0x56, 0x1E, 0x03, 0x46, 0x0E, 0x13, 0xD1, 0x8B, 0x76, \
-//			0x11, 0x60, 0x89, 0x46, 0xFC, 0x89, 0x56, 0xFE, 0xB8, 0x20, 0x00, \
-//			0xF7, 0xE6, 0x8B, 0x5E, 0x0B, 0x03, 0xC3, 0x48, 0xF7, 0xF3, 0x01, \
-//			0x46, 0xFC, 0x11, 0x4E, 0xFE, 0x61, 0xBF, 0x00, 0x00, 0xE8, 0xE6, \
-//			0x00, 0x72, 0x39, 0x26, 0x38, 0x2D, 0x74, 0x17, 0x60, 0xB1, 0x0B, \
-//			0xBE, 0xA1, 0x7D, 0xF3, 0xA6, 0x61, 0x74, 0x32, 0x4E, 0x74, 0x09, \
-//			0x83, 0xC7, 0x20, 0x3B, 0xFB, 0x72, 0xE6, 0xEB, 0xDC, 0xA0, 0xFB, \
-//			0x7D, 0xB4, 0x7D, 0x8B, 0xF0, 0xAC, 0x98, 0x40, 0x74, 0x0C, 0x48, \
-//			0x74, 0x13, 0xB4, 0x0E, 0xBB, 0x07, 0x00, 0xCD, 0x10, 0xEB, 0xEF, \
-//			0xA0, 0xFD, 0x7D, 0xEB, 0xE6, 0xA0, 0xFC, 0x7D, 0xEB, 0xE1, 0xCD, \
-//			0x16, 0xCD, 0x19, 0x26, 0x8B, 0x55, 0x1A, 0x52, 0xB0, 0x01, 0xBB, \
-//			0x00, 0x00, 0xE8, 0x3B, 0x00, 0x72, 0xE8, 0x5B, 0x8A, 0x56, 0x24, \
-//			0xBE, 0x0B, 0x7C, 0x8B, 0xFC, 0xC7, 0x46, 0xF0, 0x3D, 0x7D, 0xC7, \
-//			0x46, 0xF4, 0x29, 0x7D, 0x8C, 0xD9, 0x89, 0x4E, 0xF2, 0x89, 0x4E, \
-//			0xF6, 0xC6, 0x06, 0x96, 0x7D, 0xCB, 0xEA, 0x03, 0x00, 0x00, 0x20, \
-//			0x0F, 0xB6, 0xC8, 0x66, 0x8B, 0x46, 0xF8, 0x66, 0x03, 0x46, 0x1C, \
-//			0x66, 0x8B, 0xD0, 0x66, 0xC1, 0xEA, 0x10, 0xEB, 0x5E, 0x0F, 0xB6, \
-//			0xC8, 0x4A, 0x4A, 0x8A, 0x46, 0x0D, 0x32, 0xE4, 0xF7, 0xE2, 0x03, \
-//			0x46, 0xFC, 0x13, 0x56, 0xFE, 0xEB, 0x4A, 0x52, 0x50, 0x06, 0x53, \
-//			0x6A, 0x01, 0x6A, 0x10, 0x91, 0x8B, 0x46, 0x18, 0x96, 0x92, 0x33, \
-//			0xD2, 0xF7, 0xF6, 0x91, 0xF7, 0xF6, 0x42, 0x87, 0xCA, 0xF7, 0x76, \
-//			0x1A, 0x8A, 0xF2, 0x8A, 0xE8, 0xC0, 0xCC, 0x02, 0x0A, 0xCC, 0xB8, \
-//			0x01, 0x02, 0x80, 0x7E, 0x02, 0x0E, 0x75, 0x04, 0xB4, 0x42, 0x8B, \
-//			0xF4, 0x8A, 0x56, 0x24, 0xCD, 0x13, 0x61, 0x61, 0x72, 0x0B, 0x40, \
-//			0x75, 0x01, 0x42, 0x03, 0x5E, 0x0B, 0x49, 0x75, 0x06, 0xF8, 0xC3, \
-//			0x41, 0xBB, 0x00, 0x00, 0x60, 0x66, 0x6A, 0x00, 0xEB, 0xB0, 0x42, \
-//			0x4F, 0x4F, 0x54, 0x4D, 0x47, 0x52, 0x20, 0x20, 0x20, 0x20, 0x0D, \
-//			0x0A, 0x52, 0x65, 0x6D, 0x6F, 0x76, 0x65, 0x20, 0x64, 0x69, 0x73, \
-//			0x6B, 0x73, 0x20, 0x6F, 0x72, 0x20, 0x6F, 0x74, 0x68, 0x65, 0x72, \
-//			0x20, 0x6D, 0x65, 0x64, 0x69, 0x61, 0x2E, 0xFF, 0x0D, 0x0A, 0x44, \
-//			0x69, 0x73, 0x6B, 0x20, 0x65, 0x72, 0x72, 0x6F, 0x72, 0xFF, 0x0D, \
-//			0x0A, 0x50, 0x72, 0x65, 0x73, 0x73, 0x20, 0x61, 0x6E, 0x79, 0x20, \
-//			0x6B, 0x65, 0x79, 0x20, 0x74, 0x6F, 0x20, 0x72, 0x65, 0x73, 0x74, \
-//			0x61, 0x72, 0x74, 0x0D, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
-//			0x00, 0xAC, 0xCB, 0xD8, 0x55, 0xAA};
-//	for (i = 0; i < 512; i++) {
-//		data[i] = tmp[i];
-//	}
-//// Write to boot sector
-//	write_block(data, 0, 512);
-//
-//// Set bytes for FAT 
-//	data[0] = 0xF8;
-//	data[1] = 0xFF;
-//	data[2] = 0xFF;
-//	data[3] = 0xFF;
-//	for (i = 4; i < 512; i++) {
-//		data[i] = 0x00;
-//	}
-//// Write to first FAT 
-//	write_block(data, 0x400, 512);
-//// Write to second FAT 
-//	write_block(data, 0x1DA00, 512);
-//
-//	LED1_OFF();
-//}
-
+/**
+ * Written by Tim Johns.
+ *
+ * SD card SPI interface and FAT16 implementation.
+ *
+ * In the current circuit design, the SD card is using the USCI_A1 SPI bus, thus
+ * the functions spia_send() and spia_rec() are used.
+ */
+
+/*
+* FAT16 Boot Sector
+* 
+* Field               Offset     Length
+* -----               ------     ------
+* Bytes Per Sector      11(0Bh)    2
+* Sectors Per Cluster   13(0Dh)    1
+* Reserved Sectors      14(0Eh)    2
+* FATs                  16(10h)    1
+* Root Entries          17(11h)    2
+* Small Sectors         19(13h)    2
+* Media Descriptor      21(15h)    1
+* Sectors Per FAT       22(16h)    2
+* Sectors Per Track     24(18h)    2
+* Heads                 26(1Ah)    2
+* Hidden Sectors        28(1Ch)    4
+* Large Sectors         32(20h)    4
+*/
+
+#ifndef _SDFATLIB_C
+#define _SDFATLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "spi.h"
+#include "circuit.h"
+#include "sdfat.h"
+
+#define ACCEL_DATA		3		// Type of number
+#define GYRO_DATA		4		// Type of number
+
+/*----------------------------------------------------------------------------*/
+/* Global variables in the scope of this file								  */
+/*----------------------------------------------------------------------------*/
+// Directory table entry (MUST BE 32 BYTES)
+	uint8_t dte[] = "DATA000 WAV\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+		"\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00";
+
+// FAT sector cache: one sector of the first FAT, written back to every FAT by
+// flush_fat() so that consecutive chain updates cost a single write per FAT
+	uint8_t fat_cache[512];
+	uint32_t fat_cache_offset = FAT_CACHE_EMPTY;	// Offset of cached sector
+	uint8_t fat_cache_dirty = 0;					// Set when cache is modified
+
+// Write in progress: set while the card programs the last block written
+	uint8_t write_busy = 0;
+	uint32_t write_npolls;			// Polls left before the write times out
+
+/*----------------------------------------------------------------------------*/
+/* Initialize SD Card														  */
+/*----------------------------------------------------------------------------*/
+uint8_t init_sd(void) {
+	uint8_t short_timeout = 10;
+	uint16_t tmr, long_timeout = 0x1000;
+	uint8_t ocr[4];
+	uint8_t card_type;			// SD 1.0, 1.1, 2.0
+	uint8_t n;
+
+	CS_HIGH_SD();				// Card deselect
+
+// Must supply min of 74 clock cycles with CS high
+	for (uint8_t i = 0; i < 80; i++) spia_send(0xFF);
+	
+	CS_LOW_SD();				// Card select
+
+/* Enter SPI mode */
+	for (tmr = short_timeout; tmr && (send_cmd_sd(CMD0, 0) != 1); tmr--);
+	if (tmr == 0) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+/* Verify SD 2.0 and 2.7-3.6V */
+	if (send_cmd_sd(CMD8, 0x1AA) != 0x01) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+// Get response
+	for (n = 0; n < 4; n++) ocr[n] = spia_rec();
+// 2.7-3.6 V
+	if (ocr[2] != 0x01 || ocr[3] != 0xAA) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+/* Wait for leaving idle state (ACMD41 with HCS bit) */
+	for (tmr = long_timeout; tmr && (send_acmd_sd(ACMD41, 1UL << 30) != 0);
+		tmr--);
+	if (tmr == 0) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+/* Check High Capacity support (SDHC) */
+	if (send_cmd_sd(CMD58, 0)) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+// Get response
+	for (n = 0; n < 4; n++) ocr[n] = spia_rec();
+// SD 2.0 (HC or not)
+	card_type = (ocr[0] & 0x40) ?
+		CT_SD2 | CT_BLOCK : CT_SD2;
+
+	CS_HIGH_SD();				// Card deselect
+
+	if (card_type == CT_SD2) {	// SD 2.0
+		return 0;
+	}
+
+// SDHC
+	if (card_type == (CT_SD2 | CT_BLOCK)) {
+		return 0;
+	}
+
+// Fail: unrecognized card type
+	return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Send command to enter idle state											  */
+/*----------------------------------------------------------------------------*/
+void go_idle_sd() {
+	CS_LOW_SD();				// Card select
+	
+	send_cmd_sd(CMD0, 0);
+
+// Note: leave CS low to refrain from consuming power
+}
+
+/*----------------------------------------------------------------------------*/
+/* Send command and return error code.  Return zero for OK					  */
+/*----------------------------------------------------------------------------*/
+uint8_t send_cmd_sd(uint8_t cmd, uint32_t arg) {
+	uint8_t status;
+	uint8_t crc;
+
+	spia_send(cmd | 0x40);		// Send command
+	
+// Send argument
+	for (int8_t s = 24; s >= 0; s -= 8) spia_send(arg >> s);
+	
+/* Send CRC */
+	crc = 0xFF;
+// correct crc for CMD0 with arg 0
+	if (cmd == CMD0) crc = 0x95;
+// correct crc for CMD8 with arg 0x1AA
+	if (cmd == CMD8) crc = 0x87;
+	spia_send(crc);
+
+// Skip the stuff byte that follows STOP_TRANSMISSION
+	if (cmd == CMD12) spia_rec();
+	
+// Wait for response
+	for (uint8_t i = 0; ((status = spia_rec()) & 0x80) && i < 0xFF; i++);
+	
+	return status;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Send ACMD to SPI															  */
+/*----------------------------------------------------------------------------*/
+uint8_t send_acmd_sd(uint8_t acmd, uint32_t arg) {
+	uint8_t resp = send_cmd_sd(CMD55, 0);
+	if (resp > 1) return resp;
+	return send_cmd_sd(acmd, arg);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Wait for the card														  */
+/* Return 0 when it is ready, 1 if it is still busy after SD_BUSY_POLLS.	  */
+/*----------------------------------------------------------------------------*/
+uint8_t wait_notbusy(void) {
+	uint32_t n = SD_BUSY_POLLS;
+	while (spia_rec() != 0xFF) {
+		if (--n == 0) return 1;
+	}
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Poll the card once while it programs the last block written by			  */
+/* write_block_start() or write_multiple_send()								  */
+/* Return SD_READY once it is done (also if nothing was written), SD_BUSY	  */
+/* while it is programming, SD_TIMEOUT if it has been busy for SD_BUSY_POLLS  */
+/* polls (the write is then given up).										  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_poll(void) {
+	if (!write_busy) return SD_READY;
+
+	if (spia_rec() == 0xFF) {
+		write_busy = 0;
+		return SD_READY;
+	}
+	if (--write_npolls == 0) {
+		write_busy = 0;
+		return SD_TIMEOUT;
+	}
+	return SD_BUSY;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Poll the card until it has programmed the last block written				  */
+/* Return 0 on success, 1 on timeout.										  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_wait(void) {
+	uint8_t status;
+	while ((status = write_poll()) == SD_BUSY);
+	return status != SD_READY;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Wait for Start Block token												  */
+/*----------------------------------------------------------------------------*/
+uint8_t wait_startblock(void) {
+	uint8_t rec;
+	for (uint16_t i = 0; i < 500; i++) {
+		rec = spia_rec();
+		if (rec == 0xFE) {		// Start Block token received
+			return 0;
+		}
+		if (rec != 0xFF) {		// Error
+			return 1;
+		}
+	}
+	return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Send the data bytes of a block (count > 0)								  */
+/*----------------------------------------------------------------------------*/
+void send_block_data(const uint8_t *data, uint16_t count) {
+#if SDFAT_DMA
+	spia_dma_start(data, 0, count);
+	spia_dma_wait();
+#else
+	spia_send_burst(data, count);
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* Receive the data bytes of a block (count > 0)							  */
+/*----------------------------------------------------------------------------*/
+void rec_block_data(uint8_t *data, uint16_t count) {
+#if SDFAT_DMA
+	spia_dma_start(0, data, count);
+	spia_dma_wait();
+#else
+	spia_rec_burst(data, count);
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/* Open a multiple block write session beginning at start_offset			  */
+/* nblocks is a pre-erase hint (ACMD23) for the number of blocks that will be */
+/* written in the session (0 for no hint); it is not sent for fewer than	  */
+/* SD_HINT_BLOCKS.  The card stays selected until write_multiple_stop() or	  */
+/* write_multiple_end() is called.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_multiple_start(uint32_t start_offset, uint32_t nblocks) {
+	CS_LOW_SD();				// Card select
+
+// Wait for card to be ready
+	if (wait_notbusy()) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+/* Pre-erase hint (23-bit block count).  Cards that do not support it only
+lose the speed-up, so the response is ignored. */
+	if (nblocks >= SD_HINT_BLOCKS) {
+		if (nblocks > 0x7FFFFF) nblocks = 0x7FFFFF;
+		send_acmd_sd(ACMD23, nblocks);
+	}
+
+// WRITE_MULTIPLE_BLOCK command
+	if (send_cmd_sd(CMD25, start_offset)) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Send the given 512-byte data buffer as the next block of the open		  */
+/* multiple block write session, without waiting for the card				  */
+/* The card must be ready (write_poll() returned SD_READY).  Its busy period  */
+/* is left to write_poll(), so flash programming overlaps with filling the	  */
+/* next buffer.  The session is closed on error.							  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_multiple_send(uint8_t *data) {
+	spia_send(START_BLK_TOK);	// 'Start Block' token
+
+	send_block_data(data, 512);
+
+	spia_send(0xFF); 			// Dummy CRC
+	spia_send(0xFF); 			// Dummy CRC
+
+// Data response: block accepted?
+	if ((spia_rec() & 0x1F) != 0x05) {
+		write_multiple_stop();
+		return 1;
+	}
+
+// The card is now programming the block
+	write_busy = 1;
+	write_npolls = SD_BUSY_POLLS;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the given 512-byte data buffer as the next block of the open		  */
+/* multiple block write session												  */
+/* The card's busy period is not waited for here, but before the next block.  */
+/* The session is closed on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_multiple_block(uint8_t *data) {
+// Wait for previous block to be programmed
+	if (write_wait()) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+	return write_multiple_send(data);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Close the open multiple block write session								  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_multiple_stop(void) {
+	if (write_multiple_end()) return 1;
+
+	return check_status_sd();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Close the open multiple block write session without checking the card's	  */
+/* status: call check_status_sd() after the last of a series of sessions	  */
+/* (the card keeps its error bits until they are read)						  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_multiple_end(void) {
+/* Wait for last block to be programmed */
+	if (write_wait()) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+	spia_send(STOP_TRANS_TOK);	// 'Stop Tran' token (stop transmission)
+	spia_rec();					// Skip a byte before the busy signal
+
+// Wait for flash programming to complete
+	if (wait_notbusy()) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+	CS_HIGH_SD();				// Card deselect
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Check the card's status (SEND_STATUS) after writing						  */
+/* Return 0 if no error is reported, 1 otherwise.							  */
+/*----------------------------------------------------------------------------*/
+uint8_t check_status_sd(void) {
+	uint8_t status;
+
+	CS_LOW_SD();				// Card select
+
+	status = send_cmd_sd(CMD13, 0);
+	if (spia_rec()) status = 1;
+
+	CS_HIGH_SD();				// Card deselect
+
+	return status != 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Start writing the first count bytes in the given data buffer at offset	  */
+/* Return once the card has accepted the block: the card stays selected while */
+/* it programs it, which is polled with write_poll() before the write is	  */
+/* finished with write_block_complete().									  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_block_start(uint8_t *data, uint32_t offset, uint16_t count) {
+	CS_LOW_SD();
+	
+// WRITE_BLOCK command
+	if (send_cmd_sd(CMD24, offset)) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+	spia_send(0xFE);			// Write Single Block token
+	
+/* Write data bytes (up to 512) */
+	if (count > 512) count = 512;
+	if (count) send_block_data(data, count);
+	
+// Padding to fill block
+	for (uint16_t i = count; i < 512; i++) spia_send(0x00);
+	
+	spia_send(0xFF); 			// Dummy CRC
+	spia_send(0xFF);			// Dummy CRC
+	
+	if ((spia_rec() & 0x1F) != 0x05) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+// The card is now programming the block
+	write_busy = 1;
+	write_npolls = SD_BUSY_POLLS;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Finish the single block write once write_poll() returned SD_READY		  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_block_complete(void) {
+// Get status
+	if (send_cmd_sd(CMD13, 0) || spia_rec())	{
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+	
+	CS_HIGH_SD();				// Card deselect
+	
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the first count bytes in the given data buffer starting at offset	  */
+/*----------------------------------------------------------------------------*/
+uint8_t write_block(uint8_t *data, uint32_t offset, uint16_t count) {
+	if (write_block_start(data, offset, count)) return 1;
+
+// Wait for flash programming to complete
+	if (write_wait()) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+	return write_block_complete();
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read 512 bytes from offset and store them in the given data buffer		  */
+/*----------------------------------------------------------------------------*/
+uint8_t read_block(uint8_t *data, uint32_t offset) {
+	CS_LOW_SD();				// Card select
+	
+// READ_SINGLE_BLOCK command with offset as argument
+	if (send_cmd_sd(CMD17, offset)) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+	if (wait_startblock()) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;				// Wait for the start of the block
+	}
+	
+/* Read bytes */
+	rec_block_data(data, 512);
+	
+	CS_HIGH_SD();				// Card deselect
+	
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Open a multiple block read session beginning at start_offset				  */
+/* The card stays selected until read_multiple_stop() is called.			  */
+/*----------------------------------------------------------------------------*/
+uint8_t read_multiple_start(uint32_t start_offset) {
+	CS_LOW_SD();				// Card select
+
+// READ_MULTIPLE_BLOCK command
+	if (send_cmd_sd(CMD18, start_offset)) {
+		CS_HIGH_SD();			// Card deselect
+		return 1;
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Read the next 512 bytes of the open multiple block read session into the	  */
+/* given data buffer														  */
+/* The session is closed on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t read_multiple_block(uint8_t *data) {
+	if (wait_startblock()) {	// Wait for the start of the block
+		read_multiple_stop();
+		return 1;
+	}
+
+/* Read bytes */
+	rec_block_data(data, 512);
+
+	spia_rec();					// Discard CRC
+	spia_rec();					// Discard CRC
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Close the open multiple block read session								  */
+/*----------------------------------------------------------------------------*/
+uint8_t read_multiple_stop(void) {
+	uint8_t status;
+
+// STOP_TRANSMISSION command
+	status = send_cmd_sd(CMD12, 0);
+
+// Wait for the card to be ready
+	if (wait_notbusy()) status = 1;
+
+	CS_HIGH_SD();				// Card deselect
+
+	return status != 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Copy nblocks consecutive blocks from src_offset to dst_offset			  */
+/* The data buffer must hold nbuf blocks (nbuf * 512 bytes).  Blocks are	  */
+/* moved in runs of up to nbuf: one multiple block read session fills the	  */
+/* buffer, then one multiple block write session empties it.  The write		  */
+/* sessions are not followed by a status check: call check_status_sd() once	  */
+/* the copy is done.														  */
+/*----------------------------------------------------------------------------*/
+uint8_t copy_blocks(	uint8_t *data, uint16_t nbuf,
+						uint32_t src_offset, uint32_t dst_offset,
+						uint32_t nblocks) {
+	uint16_t i, n;
+
+	while (nblocks > 0) {
+		n = (nblocks < nbuf) ? (uint16_t)nblocks : nbuf;
+
+/* Read a run of blocks */
+		if (read_multiple_start(src_offset)) return 1;
+		for (i = 0; i < n; i++) {
+			if (read_multiple_block(data + i * 512)) return 1;
+		}
+		if (read_multiple_stop()) return 1;
+
+/* Write the run of blocks */
+		if (write_multiple_start(dst_offset, n)) return 1;
+		for (i = 0; i < n; i++) {
+			if (write_multiple_block(data + i * 512)) return 1;
+		}
+		if (write_multiple_end()) return 1;
+
+		src_offset += (uint32_t)n * 512;
+		dst_offset += (uint32_t)n * 512;
+		nblocks -= n;
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Load the FAT sector at offset into the FAT cache							  */
+/* A dirty sector is written back first.									  */
+/*----------------------------------------------------------------------------*/
+uint8_t load_fat_sector(struct fatstruct *info, uint32_t offset) {
+	if (offset == fat_cache_offset) return 0;
+
+	if (flush_fat(info)) return 1;
+
+	fat_cache_offset = FAT_CACHE_EMPTY;
+	if (read_block(fat_cache, offset)) return 1;
+	fat_cache_offset = offset;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write the cached FAT sector back to every FAT if it has been modified	  */
+/*----------------------------------------------------------------------------*/
+uint8_t flush_fat(struct fatstruct *info) {
+	if (!fat_cache_dirty) return 0;
+
+	for (uint8_t n = 0; n < info->nfats; n++) {
+		if (write_block(fat_cache, fat_cache_offset + n * info->fatsize, 512))
+			return 1;
+	}
+	fat_cache_dirty = 0;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the FAT sector at offset for scanning: the FAT cache if it holds	  */
+/* that sector (pending updates stay in place), otherwise the data buffer	  */
+/* after reading the sector into it.  Return 0 on error.					  */
+/*----------------------------------------------------------------------------*/
+uint8_t *read_fat_sector(uint8_t *data, uint32_t offset) {
+	if (offset == fat_cache_offset) return fat_cache;
+	if (read_block(data, offset)) return 0;
+	return data;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Count the free clusters and find the first one (call once at mount)		  */
+/*----------------------------------------------------------------------------*/
+uint8_t scan_fat(uint8_t *data, struct fatstruct *info) {
+	uint32_t i;
+	uint16_t j;
+
+	info->nfreeclusts = 0;
+	info->nextfree = 2;
+
+	for (i = 4; i < info->nclusts * 2UL; i += 2) {
+		j = i % 512;			// Cluster index relative to block
+
+/* Read each new block of the FAT (skipping clusters 0 and 1) */
+		if (j == 0 || i == 4) {
+			if (read_block(data, info->fatoffset + i - j)) return 1;
+		}
+
+		if (data[j] == 0x00 && data[j+1] == 0x00) {
+			if (info->nfreeclusts == 0) info->nextfree = (uint16_t)(i / 2);
+			info->nfreeclusts++;
+		}
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Find and return a free cluster for writing file contents					  */
+/* The search resumes at the next free cluster hint and wraps around once.	  */
+/* The data buffer is used to scan FAT sectors other than the cached one, so  */
+/* the scan does not flush pending chain updates.  The cluster is marked as	  */
+/* end of chain in the FAT cache; call flush_fat() to commit it.			  */
+/* Return free cluster index (>0).											  */
+/* Return 0 on error or if there are no more free clusters.					  */
+/*----------------------------------------------------------------------------*/
+uint16_t find_cluster(uint8_t *data, struct fatstruct *info) {
+	uint32_t block_offset = FAT_CACHE_EMPTY;
+	uint32_t i;
+	uint16_t clust = info->nextfree;
+	uint16_t n, j;
+	uint8_t *sect = data;		// FAT sector being scanned
+
+// Disk is full
+	if (info->nfreeclusts == 0) return 0;
+
+	for (n = info->nclusts - 2; n > 0; n--, clust++) {
+		if (clust >= info->nclusts) clust = 2;	// Wrap around
+
+		i = clust * 2UL;
+		j = i % 512;			// Cluster index relative to block
+
+/* Read each new block of the FAT */
+		if (info->fatoffset + i - j != block_offset) {
+			block_offset = info->fatoffset + i - j;
+			if ((sect = read_fat_sector(data, block_offset)) == 0) return 0;
+		}
+
+		if (sect[j] == 0x00 && sect[j+1] == 0x00) {
+
+/* Move the block into the FAT cache */
+			if (sect == data) {
+				if (flush_fat(info)) return 0;
+				for (uint16_t k = 0; k < 512; k++) fat_cache[k] = data[k];
+				fat_cache_offset = block_offset;
+			}
+
+/* Set cluster to 0xFFFF to indicate end of cluster chain for current file
+(will be modified if file data continues) */
+			fat_cache[j] = 0xFF;
+			fat_cache[j+1] = 0xFF;
+			fat_cache_dirty = 1;
+
+			info->nfreeclusts--;
+			info->nextfree = clust + 1;
+
+// Return free cluster index
+			return clust;
+		}
+	}
+
+// Failed to find a free cluster (free count was wrong)
+	info->nfreeclusts = 0;
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Allocate n contiguous free clusters and chain them in the FAT cache		  */
+/* Free runs are searched from the next free cluster hint to the end of the	  */
+/* FAT, then from cluster 2 up to the hint (and the n - 1 clusters past it,	  */
+/* for a run that straddles it).  Call flush_fat() to commit the chain.		  */
+/* Return the first cluster of the extent.									  */
+/* Return 0 on error or if there is no run of n free clusters.				  */
+/*----------------------------------------------------------------------------*/
+uint16_t alloc_extent(uint8_t *data, struct fatstruct *info, uint16_t n) {
+	uint32_t block_offset = FAT_CACHE_EMPTY;
+	uint32_t i;
+	uint16_t clust = info->nextfree;
+	uint16_t end = info->nclusts;
+	uint16_t first = 0;			// First cluster of the current free run
+	uint16_t run, j;
+	uint8_t *sect = data;		// FAT sector being scanned
+
+	if (n == 0 || info->nfreeclusts < n) return 0;
+
+	for (uint8_t pass = 0; pass < 2; pass++) {
+		for (run = 0; clust < end; clust++) {
+			i = clust * 2UL;
+			j = i % 512;		// Cluster index relative to block
+
+/* Read each new block of the FAT */
+			if (info->fatoffset + i - j != block_offset) {
+				block_offset = info->fatoffset + i - j;
+				sect = read_fat_sector(data, block_offset);
+				if (sect == 0) return 0;
+			}
+
+			if (sect[j] == 0x00 && sect[j+1] == 0x00) {
+				if (run == 0) first = clust;
+				if (++run == n) break;
+			} else {
+				run = 0;
+			}
+		}
+		if (run == n) break;
+
+// Second pass: below the hint, and across it for a run that straddles it
+		end = info->nclusts;
+		if ((uint32_t)info->nextfree + n - 1 < end)
+			end = info->nextfree + n - 1;
+		clust = 2;
+	}
+	if (run != n) return 0;
+
+/* Chain the extent (each cluster points to the next, the last one ends the
+chain) */
+	for (clust = first; clust < first + n - 1; clust++) {
+		if (update_fat(info, clust * 2UL, clust + 1)) return 0;
+	}
+	if (update_fat(info, clust * 2UL, 0xFFFF)) return 0;
+
+	if (first == info->nextfree) info->nextfree = first + n;
+
+	return first;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the offset of the given cluster number							  */
+/*----------------------------------------------------------------------------*/
+uint32_t get_cluster_offset(uint16_t clust, struct fatstruct *info) {
+	return info->fileclustoffset + ((clust - 2) * info->nbytesinclust);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return true iff block number is less than nsectsinclust					  */
+/*----------------------------------------------------------------------------*/
+uint8_t valid_block(uint8_t block, struct fatstruct *info) {
+	return block < info->nsectsinclust;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the FAT entry of cluster clust (the next cluster in its chain, or	  */
+/* 0xFFF8 and above at the end of the chain), read through the FAT cache.	  */
+/* Return 0 on error.														  */
+/*----------------------------------------------------------------------------*/
+uint16_t next_cluster(struct fatstruct *info, uint16_t clust) {
+	uint32_t index = clust * 2UL;
+
+// Load the right block of the FAT
+	if (load_fat_sector(info, info->fatoffset + index - (index % 512)))
+		return 0;
+
+	index = index % 512;		// Change index from absolute to relative
+
+	return fat_cache[index] | ((uint16_t)fat_cache[index+1] << 8);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Update the FAT															  */
+/* Replace the cluster word at byte offset index with num in the FAT cache;	  */
+/* call flush_fat() to commit it.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t update_fat(struct fatstruct *info, uint32_t index, uint16_t num) {
+	uint16_t clust = (uint16_t)(index / 2);
+
+// Load the right block of the FAT
+	if (load_fat_sector(info, info->fatoffset + index - (index % 512)))
+		return 1;
+
+	index = index % 512;		// Change index from absolute to relative
+
+/* Keep the free space count and hint up to date */
+	if (fat_cache[index] == 0x00 && fat_cache[index+1] == 0x00) {
+		if (num != 0) info->nfreeclusts--;
+	} else if (num == 0) {
+		info->nfreeclusts++;
+		if (clust < info->nextfree) info->nextfree = clust;
+	}
+
+/* Point cluster word at index to num cluster */
+	fat_cache[index] = (uint8_t)num;
+	fat_cache[index+1] = (uint8_t)(num >> 8);
+	fat_cache_dirty = 1;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Update directory table													  */
+/* cluster: file's starting cluster											  */
+/* file_size: total bytes in file											  */
+/* file_num: file name number suffix										  */
+/*----------------------------------------------------------------------------*/
+uint8_t update_dir_table(	uint8_t *data,
+							struct fatstruct *info,
+							uint16_t cluster,
+							uint32_t file_size,
+							uint16_t file_num) {
+// Set filename prefix
+	dte[0] = 'D'; dte[1] = 'A'; dte[2] = 'T'; dte[3] = 'A';
+
+/* Set filename suffix (e.g., "012") */
+	dte[4] = MOD16(DIV16(file_num, 100), 10) + 0x30;
+	dte[5] = MOD16(DIV16(file_num, 10), 10) + 0x30;
+	dte[6] = MOD16(file_num, 10) + 0x30;
+
+/* Set starting cluster */
+	dte[27] = (uint8_t)(cluster >> 8);
+	dte[26] = (uint8_t)(cluster);
+
+/* Set file size */
+	dte[31] = (uint8_t)(file_size >> 24);
+	dte[30] = (uint8_t)(file_size >> 16);
+	dte[29] = (uint8_t)(file_size >> 8);
+	dte[28] = (uint8_t)(file_size);
+
+	if (add_dir_entry(data, info, dte)) return 1;
+
+// Keep the directory index up to date
+	if (file_num >= info->nextfilenum) info->nextfilenum = file_num + 1;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Write a 32-byte directory table entry to the first free slot, found in the */
+/* directory index, and move the index on to the next free slot				  */
+/* Return 0 on success, 1 on error or if the directory table is full.		  */
+/*----------------------------------------------------------------------------*/
+uint8_t add_dir_entry(uint8_t *data, struct fatstruct *info, uint8_t *entry) {
+	uint32_t i = info->freeentry;
+	uint16_t j;
+	uint8_t end;				// Set if the slot was past the last entry
+
+// Check if directory table is full
+	if (i >= info->dtsize) return 1;
+
+// Offset of the sector holding the entry
+	uint32_t sect_offset = info->dtoffset + i - SECT_REM(i, info);
+
+	if (read_block(data, sect_offset)) return 1;
+
+/* Update directory table with new directory table entry */
+	end = (data[i % 512] == 0x00);
+	for (j = 0; j < 32; j++) {
+		data[(i % 512) + j] = entry[j];
+	}
+
+/* We can only write blocks of nbytesinsect bytes, so make sure the offset
+we're writing to is at the beginning of a sector */
+	if (write_block(data, sect_offset, 512)) return 1;
+
+/* Find the next free slot: right after the last entry, or else the next
+deleted entry (the sector in the data buffer is searched first) */
+	for (i += 32; !end && i < info->dtsize; i += 32) {
+		if (SECT_REM(i, info) == 0) {
+			if (read_block(data, info->dtoffset + i)) {
+				info->freeentry = info->dtsize;		// Unknown
+				return 1;
+			}
+		}
+		if (data[i % 512] == 0x00 || data[i % 512] == 0xE5) break;
+	}
+	info->freeentry = i;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Find the directory table entry with the 11-character name (8.3 format,	  */
+/* space padded, no dot)													  */
+/* Return the entry's offset, or 0 if it is not found or on error.			  */
+/*----------------------------------------------------------------------------*/
+uint32_t find_dir_entry(uint8_t *data, struct fatstruct *info,
+						const uint8_t *name) {
+	uint32_t i;
+	uint16_t j;
+	for (i = 0; i < info->dtsize; i += 32) {
+		if (SECT_REM(i, info) == 0) {
+// Next sector
+			if (read_block(data, info->dtoffset + i)) return 0;
+		}
+
+// 0x00 marks the end of directory table entries
+		if (data[i % 512] == 0x00) return 0;
+
+		for (j = 0; j < 11 && data[(i % 512) + j] == name[j]; j++);
+		if (j == 11) return info->dtoffset + i;
+	}
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Find the file with the 11-character name, creating it with the given		  */
+/* attributes as one contiguous extent of nclusts clusters if it does not	  */
+/* exist, and store the offset of its directory table entry in *dteoffset	  */
+/* The data buffer must hold one block.										  */
+/* Return the file's first cluster, or 0 on error.							  */
+/*----------------------------------------------------------------------------*/
+uint16_t open_file(	uint8_t *data, struct fatstruct *info,
+					const uint8_t *name, uint8_t attr, uint16_t nclusts,
+					uint32_t *dteoffset) {
+	uint8_t entry[32];				// New directory table entry
+	uint32_t size = nclusts * info->nbytesinclust;
+	uint16_t first;
+	uint16_t i;
+
+	*dteoffset = find_dir_entry(data, info, name);
+	if (*dteoffset == 0) {
+/* Create the file */
+		if ((first = alloc_extent(data, info, nclusts)) == 0) return 0;
+		if (flush_fat(info)) return 0;
+
+		for (i = 0; i < 32; i++) entry[i] = 0x00;
+		for (i = 0; i < 11; i++) entry[i] = name[i];
+		entry[11] = attr;
+		entry[26] = (uint8_t)(first);
+		entry[27] = (uint8_t)(first >> 8);
+		entry[28] = (uint8_t)(size);
+		entry[29] = (uint8_t)(size >> 8);
+		entry[30] = (uint8_t)(size >> 16);
+		entry[31] = (uint8_t)(size >> 24);
+		if (add_dir_entry(data, info, entry)) return 0;
+
+		*dteoffset = find_dir_entry(data, info, name);
+		if (*dteoffset == 0) return 0;
+	}
+
+// Starting cluster from the directory table entry
+	if (read_block(data, *dteoffset - SECT_REM(*dteoffset, info))) return 0;
+	i = SECT_REM(*dteoffset, info);
+	first = data[i+26] | ((uint16_t)data[i+27] << 8);
+	if (first < 2 || first >= info->nclusts) return 0;
+
+	return first;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Find the boot sector, read it (store in data buffer), and verify its		  */
+/* validity																	  */
+/*----------------------------------------------------------------------------*/
+uint8_t read_boot_sector(uint8_t *data, struct fatstruct *boot) {
+/* Find boot sector */
+	boot->nhidsects = 0;
+	boot->bootoffset = 0;
+// Read first sector
+	if (read_block(data, 0)) return 1;
+	
+// Check if the first sector is the boot sector
+	if (data[0x00] == 0x00) {
+// First sector is not boot sector, find location of boot sector
+// number of hidden sectors: 4 bytes at offset 0x1C6
+		boot->nhidsects = data[0x1C6] |
+						 ((uint32_t)data[0x1C7] << 8) |
+						 ((uint32_t)data[0x1C8] << 16) |
+						 ((uint32_t)data[0x1C9] << 24);
+// Location of boot sector
+		boot->bootoffset = boot->nhidsects * 512;
+// Read boot sector and store in data buffer
+		if (read_block(data, boot->bootoffset)) return 1;
+	}
+	
+// Verify validity of boot sector
+	if ((data[0x1FE] | (data[0x1FF] << 8)) != 0xAA55) return 1;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Parse the FAT16 boot sector												  */
+/*----------------------------------------------------------------------------*/
+uint8_t parse_boot_sector(uint8_t *data, struct fatstruct *info) {
+	uint32_t tmp32;
+
+// Is the SD card formatted to FAT16?
+	if ( !(data[0x36] == 'F' &&
+		   data[0x37] == 'A' &&
+		   data[0x38] == 'T' &&
+		   data[0x39] == '1' &&
+		   data[0x3A] == '6') ) {
+		return 1;
+	}
+
+/********************************************************/
+/* Fill valuable global variables						*/
+/*														*/
+/* bytes per sector:			2 bytes	at offset 0x0B	*/
+/* sectors per cluster:			1 byte	at offset 0x0D	*/
+/* number of reserved sectors:	2 bytes	at offset 0x0E	*/
+/* number of FATs:				1 byte	at offset 0x10	*/
+/* max directory entries:		2 bytes	at offset 0x11	*/
+/* number of sectors per FAT:	2 bytes	at offset 0x16	*/
+/* total sectors:				4 bytes	at offset 0x20	*/
+/********************************************************/
+	info->nbytesinsect = data[0x0B] | (data[0x0C] << 8);
+	info->nsectsinclust = data[0x0D];
+	info->nbytesinclust =
+		(uint32_t)info->nbytesinsect * (uint32_t)info->nsectsinclust;
+	info->nressects = data[0x0E] | (data[0x0F] << 8);
+	info->nfats = data[0x10];
+	info->dtsize = (data[0x11] | (data[0x12] << 8)) * 32;
+	info->nsectsinfat = data[0x16] | (data[0x17] << 8);
+// Total sectors: small sectors field, or large sectors field if that is 0
+	info->nsects = data[0x13] | (data[0x14] << 8);
+	if (info->nsects == 0) {
+		info->nsects = data[0x20] | ((uint32_t)data[0x21] << 8) |
+			((uint32_t)data[0x22] << 16) | ((uint32_t)data[0x23] << 24);
+	}
+	
+// Only compatible with sectors of 512 bytes
+	if (info->nbytesinsect != 512) return 2;
+
+/* Cluster size must be a power of two */
+	for (info->clustshift = 9;
+		(1UL << info->clustshift) < info->nbytesinclust; info->clustshift++);
+	if ((1UL << info->clustshift) != info->nbytesinclust) return 2;
+	
+/* Get location of FAT */
+	info->fatsize = (uint32_t)info->nbytesinsect * (uint32_t)info->nsectsinfat;
+	info->fatoffset = (uint32_t)info->nressects * (uint32_t)info->nbytesinsect +
+				 info->bootoffset;
+	
+// Get location of directory table
+	info->dtoffset = (uint32_t)info->nbytesinsect *
+						(uint32_t)info->nressects +
+						512 * (uint32_t)info->nsectsinfat *
+		(uint32_t)info->nfats +
+		info->bootoffset;
+	
+// Get location of first cluster to be used by file data
+	info->fileclustoffset = info->dtoffset + info->dtsize;
+
+/* Number of clusters in the data region, limited by what the FAT can hold */
+	tmp32 = info->nsects - (info->fileclustoffset - info->bootoffset) / 512;
+#if SDFAT_SECT512
+	tmp32 = (tmp32 >> (info->clustshift - 9)) + 2;
+#else
+	tmp32 = DIV32(tmp32, info->nsectsinclust) + 2;
+#endif
+	if (tmp32 > info->fatsize / 2) tmp32 = info->fatsize / 2;
+	if (tmp32 > 0xFFF0) tmp32 = 0xFFF0;
+	info->nclusts = (uint16_t)tmp32;
+
+// Free space is unknown until scan_fat()
+	info->nfreeclusts = 0;
+	info->nextfree = 2;
+
+// The directory index is empty until scan_dir()
+	info->nextfilenum = 1;
+	info->freeentry = info->dtsize;
+
+// Nothing cached from a previous card
+	fat_cache_offset = FAT_CACHE_EMPTY;
+	fat_cache_dirty = 0;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Build the directory index (call once at mount): scan the directory table	  */
+/* for the highest file number suffix and the first free entry				  */
+/* Return 0 on success, 1 on error.											  */
+/*----------------------------------------------------------------------------*/
+uint8_t scan_dir(uint8_t *data, struct fatstruct *info) {
+	uint16_t max = 0;			// Highest file number suffix
+	uint16_t tmp16, x;			// Temporary storage
+	uint32_t i;					// Directory table byte count
+	uint16_t j;					// Directory table entry address
+	uint8_t k;
+
+	info->nextfilenum = 1;
+	info->freeentry = info->dtsize;
+
+	for (i = 0; i < info->dtsize; i += 32) {
+		j = SECT_REM(i, info);
+// Check for end of sector
+		if (j == 0) {
+// Read next sector
+			if (read_block(data, info->dtoffset + i)) return 1;
+		}
+
+// 0x00 marks the end of directory table entries (the rest is free)
+		if (data[j] == 0x00) {
+			if (info->freeentry == info->dtsize) info->freeentry = i;
+			break;
+		}
+
+// 0xE5 marks a deleted file
+		if (data[j] == 0xE5) {
+			if (info->freeentry == info->dtsize) info->freeentry = i;
+			continue;
+		}
+
+/* Convert 3 byte ASCII file number suffix to integer */
+		x = 0;
+		for (k = 4; k < 7; k++) {
+			tmp16 = data[j+k] - 0x30;
+			if (tmp16 > 9) break;
+			x = x * 10 + tmp16;
+		}
+
+// Keep track of highest file number suffix
+		if (k == 7 && x > max) max = x;
+	}
+
+// The highest usable file number suffix
+	info->nextfilenum = max + 1;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return the next file number suffix (one above the highest in use), from	  */
+/* the directory index														  */
+/*----------------------------------------------------------------------------*/
+uint16_t get_file_num(struct fatstruct *info) {
+	return info->nextfilenum;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Format the SD card to FAT16 (quick format)								  */
+/*----------------------------------------------------------------------------*/
+//void format_sd(uint8_t *data) {
+//	uint16_t i;
+//	uint32_t j;
+//
+//// Set data buffer to null bytes for filling SD card sectors
+//	for (i = 0; i < 512; i++) {
+//		data[i] = 0x00;
+//	}
+//
+//// Fill with null bytes from offset 0h to 3F000h (not including 3F000h)
+//	for (j = 0; j < 0x3F000; j += 512) {
+//		write_block(data, j, 512);
+//		if (j % 2048 == 0) {
+//			LED1_TOGGLE();			// Flash LED to signal formatting
+//		}
+//	}
+//
+//	LED1_ON();
+//
+//// Initialize bytes for boot sector
+//// (temporary variable for clean initialization)
+//	uint8_t tmp[] = {
+//			0xEB, 0x3C, 0x90, 0x4D, 0x53, 0x44, 0x4F, 0x53, 0x35, 0x2E, 0x30, \
+//			0x00, 0x02, 0x40, 0x02, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0xF8, \
+//			0xEB, 0x00, 0x3F, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+//			0xA0, 0x3A, 0x00, 0x80, 0x00, 0x29, 0xFF, 0xFF, 0xFF, 0xFF, 0x4E, \
+//			0x4F, 0x20, 0x4E, 0x41, 0x4D, 0x45, 0x20, 0x20, 0x20, 0x20, 0x46, \
+//			0x41, 0x54, 0x31, 0x36, 0x20, 0x20, 0x20, 0x33, 0xC9, 0x8E, 0xD1, \
+//			0xBC, 0xF0, 0x7B, 0x8E, 0xD9, 0xB8, 0x00, 0x20, 0x8E, 0xC0, 0xFC, \
+//			0xBD, 0x00, 0x7C, 0x38, 0x4E, 0x24, 0x7D, 0x24, 0x8B, 0xC1, 0x99, \
+//			0xE8, 0x3C, 0x01, 0x72, 0x1C, 0x83, 0xEB, 0x3A, 0x66, 0xA1, 0x1C, \
+//			0x7C, 0x26, 0x66, 0x3B, 0x07, 0x26, 0x8A, 0x57, 0xFC, 0x75, 0x06, \
+//			0x80, 0xCA, 0x02, 0x88, 0x56, 0x02, 0x80, 0xC3, 0x10, 0x73, 0xEB, \
+//			0x33, 0xC9, 0x8A, 0x46, 0x10, 0x98, 0xF7, 0x66, 0x16, 0x03, 0x46, \
+//			0x1C, 0x13, 0x56, 0x1E, 0x03, 0x46, 0x0E, 0x13, 0xD1, 0x8B, 0x76, \
+//			0x11, 0x60, 0x89, 0x46, 0xFC, 0x89, 0x56, 0xFE, 0xB8, 0x20, 0x00, \
+//			0xF7, 0xE6, 0x8B, 0x5E, 0x0B, 0x03, 0xC3, 0x48, 0xF7, 0xF3, 0x01, \
+//			0x46, 0xFC, 0x11, 0x4E, 0xFE, 0x61, 0xBF, 0x00, 0x00, 0xE8, 0xE6, \
+//			0x00, 0x72, 0x39, 0x26, 0x38, 0x2D, 0x74, 0x17, 0x60, 0xB1, 0x0B, \
+//			0xBE, 0xA1, 0x7D, 0xF3, 0xA6, 0x61, 0x74, 0x32, 0x4E, 0x74, 0x09, \
+//			0x83, 0xC7, 0x20, 0x3B, 0xFB, 0x72, 0xE6, 0xEB, 0xDC, 0xA0, 0xFB, \
+//			0x7D, 0xB4, 0x7D, 0x8B, 0xF0, 0xAC, 0x98, 0x40, 0x74, 0x0C, 0x48, \
+//			0x74, 0x13, 0xB4, 0x0E, 0xBB, 0x07, 0x00, 0xCD, 0x10, 0xEB, 0xEF, \
+//			0xA0, 0xFD, 0x7D, 0xEB, 0xE6, 0xA0, 0xFC, 0x7D, 0xEB, 0xE1, 0xCD, \
+//			0x16, 0xCD, 0x19, 0x26, 0x8B, 0x55, 0x1A, 0x52, 0xB0, 0x01, 0xBB, \
+//			0x00, 0x00, 0xE8, 0x3B, 0x00, 0x72, 0xE8, 0x5B, 0x8A, 0x56, 0x24, \
+//			0xBE, 0x0B, 0x7C, 0x8B, 0xFC, 0xC7, 0x46, 0xF0, 0x3D, 0x7D, 0xC7, \
+//			0x46, 0xF4, 0x29, 0x7D, 0x8C, 0xD9, 0x89, 0x4E, 0xF2, 0x89, 0x4E, \
+//			0xF6, 0xC6, 0x06, 0x96, 0x7D, 0xCB, 0xEA, 0x03, 0x00, 0x00, 0x20, \
+//			0x0F, 0xB6, 0xC8, 0x66, 0x8B, 0x46, 0xF8, 0x66, 0x03, 0x46, 0x1C, \
+//			0x66, 0x8B, 0xD0, 0x66, 0xC1, 0xEA, 0x10, 0xEB, 0x5E, 0x0F, 0xB6, \
+//			0xC8, 0x4A, 0x4A, 0x8A, 0x46, 0x0D, 0x32, 0xE4, 0xF7, 0xE2, 0x03, \
+//			0x46, 0xFC, 0x13, 0x56, 0xFE, 0xEB, 0x4A, 0x52, 0x50, 0x06, 0x53, \
+//			0x6A, 0x01, 0x6A, 0x10, 0x91, 0x8B, 0x46, 0x18, 0x96, 0x92, 0x33, \
+//			0xD2, 0xF7, 0xF6, 0x91, 0xF7, 0xF6, 0x42, 0x87, 0xCA, 0xF7, 0x76, \
+//			0x1A, 0x8A, 0xF2, 0x8A, 0xE8, 0xC0, 0xCC, 0x02, 0x0A, 0xCC, 0xB8, \
+//			0x01, 0x02, 0x80, 0x7E, 0x02, 0x0E, 0x75, 0x04, 0xB4, 0x42, 0x8B, \
+//			0xF4, 0x8A, 0x56, 0x24, 0xCD, 0x13, 0x61, 0x61, 0x72, 0x0B, 0x40, \
+//			0x75, 0x01, 0x42, 0x03, 0x5E, 0x0B, 0x49, 0x75, 0x06, 0xF8, 0xC3, \
+//			0x41, 0xBB, 0x00, 0x00, 0x60, 0x66, 0x6A, 0x00, 0xEB, 0xB0, 0x42, \
+//			0x4F, 0x4F, 0x54, 0x4D, 0x47, 0x52, 0x20, 0x20, 0x20, 0x20, 0x0D, \
+//			0x0A, 0x52, 0x65, 0x6D, 0x6F, 0x76, 0x65, 0x20, 0x64, 0x69, 0x73, \
+//			0x6B, 0x73, 0x20, 0x6F, 0x72, 0x20, 0x6F, 0x74, 0x68, 0x65, 0x72, \
+//			0x20, 0x6D, 0x65, 0x64, 0x69, 0x61, 0x2E, 0xFF, 0x0D, 0x0A, 0x44, \
+//			0x69, 0x73, 0x6B, 0x20, 0x65, 0x72, 0x72, 0x6F, 0x72, 0xFF, 0x0D, \
+//			0x0A, 0x50, 0x72, 0x65, 0x73, 0x73, 0x20, 0x61, 0x6E, 0x79, 0x20, \
+//			0x6B, 0x65, 0x79, 0x20, 0x74, 0x6F, 0x20, 0x72, 0x65, 0x73, 0x74, \
+//			0x61, 0x72, 0x74, 0x0D, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+//			0x00, 0xAC, 0xCB, 0xD8, 0x55, 0xAA};
+//	for (i = 0; i < 512; i++) {
+//		data[i] = tmp[i];
+//	}
+//// Write to boot sector
+//	write_block(data, 0, 512);
+//
+//// Set bytes for FAT 
+//	data[0] = 0xF8;
+//	data[1] = 0xFF;
+//	data[2] = 0xFF;
+//	data[3] = 0xFF;
+//	for (i = 4; i < 512; i++) {
+//		data[i] = 0x00;
+//	}
+//// Write to first FAT 
+//	write_block(data, 0x400, 512);
+//// Write to second FAT 
+//	write_block(data, 0x1DA00, 512);
+//
+//	LED1_OFF();
+//}
+
 #endif
\ No newline at end of file
@@ -1,74 +1,177 @@
-/**
- * Written by Tim Johns.
- * 
- * SD card SPI interface and FAT16 implementation library.
- *
- * Remember to change the CS_LOW_SD() and CS_HIGH_SD() definitions for a new
- * circuit design.
- */
-
-#ifndef _SDFATLIB_H
-#define _SDFATLIB_H
-
-// SD Card Commands
-#define CMD0	0		// GO_IDLE_STATE
-#define CMD8	8		// SEND_IF_COND
-#define CMD13	13		// SEND_STATUS
-#define CMD17	17		// READ_SINGLE_BLOCK
-#define CMD24	24		// WRITE_BLOCK
-//#define CMD25	25		// WRITE_MULTIPLE_BLOCK
-#define CMD55	55		// APP_CMD
-#define CMD58	58		// READ_OCR
-#define ACMD41	41		// SD_SEND_OP_COND
-
-// SD Card Tokens for Multiple Block Write
-//#define START_BLK_TOK	0xFC	// 'Start Block' token
-//#define STOP_TRANS_TOK	0xFD	// 'Stop Tran' token (stop transmission)
-
-// SD Card type flags (CardType)
-#define CT_MMC				0x01			// MMC ver 3
-#define CT_SD1				0x02			// SD ver 1
-#define CT_SD2				0x04			// SD ver 2
-#define CT_SDC				(CT_SD1|CT_SD2)	// SD
-#define CT_BLOCK			0x08			// Block addressing
-
-#define CS_LOW_SD()  P4OUT &= ~(0x80)		// Card Select (P4.7)
-#define CS_HIGH_SD() P4OUT |= 0x80			// Card Deselect (P4.7)
-
-struct fatstruct {					// FAT information based on boot sector
-	uint16_t nbytesinsect;			// Number of bytes per sector, should be 512
-	uint8_t nsectsinclust;			// Number of sectors per cluster
-	uint32_t nbytesinclust;			// bytes per sector * sectors per cluster
-	uint16_t nressects;				// Number of reserved sectors from offset 0
-	uint16_t nsectsinfat;			// Number of sectors per FAT 
-	uint8_t nfats;					// Number of FATs
-	uint32_t fatsize;				// Number of bytes per FAT 
-	uint32_t fatoffset;				// Offset of the first FAT 
-	uint32_t dtoffset;				// Offset of the directory table
-	uint32_t dtsize;				// Size of directory table in bytes
-	uint32_t nsects;				// Number of sectors in the partition
-	uint32_t fileclustoffset;		// Offset of the first cluster for file data
-	uint32_t nhidsects;				// Number of hidden sectors
-// Offset of the boot record sector, determined by number of hidden sectors
-	uint32_t bootoffset;
-};
-
-uint8_t init_sd(void);
-void go_idle_sd(void);
-uint8_t send_cmd_sd(uint8_t cmd, uint32_t arg);
-uint8_t send_acmd_sd(uint8_t acmd, uint32_t arg);
-//uint8_t write_multiple_block(uint32_t start_offset);
-uint8_t write_block(uint8_t *data, uint32_t offset, uint16_t count);
-uint8_t read_block(uint8_t *data, uint32_t offset);
-uint16_t find_cluster(uint8_t *data, struct fatstruct *);
-uint32_t get_cluster_offset(uint16_t clust, struct fatstruct *);
-uint8_t valid_block(uint8_t block, struct fatstruct *);
-uint8_t update_fat(uint8_t *data, struct fatstruct *, uint16_t, uint16_t);
-uint8_t update_dir_table(	uint8_t *data, struct fatstruct *,
-							uint16_t, uint32_t, uint16_t);
-uint8_t read_boot_sector(uint8_t *data, struct fatstruct *);
-uint8_t parse_boot_sector(uint8_t *data, struct fatstruct *);
-uint16_t get_file_num(uint8_t *data, struct fatstruct *);
-//void format_sd(uint8_t *data);
-
+/**
+ * Written by Tim Johns.
+ * 
+ * SD card SPI interface and FAT16 implementation library.
+ *
+ * Remember to change the CS_LOW_SD() and CS_HIGH_SD() definitions for a new
+ * circuit design.
+ */
+
+#ifndef _SDFATLIB_H
+#define _SDFATLIB_H
+
+// SD Card Commands
+#define CMD0	0		// GO_IDLE_STATE
+#define CMD8	8		// SEND_IF_COND
+#define CMD12	12		// STOP_TRANSMISSION
+#define CMD13	13		// SEND_STATUS
+#define CMD17	17		// READ_SINGLE_BLOCK
+#define CMD18	18		// READ_MULTIPLE_BLOCK
+#define CMD24	24		// WRITE_BLOCK
+#define CMD25	25		// WRITE_MULTIPLE_BLOCK
+#define CMD55	55		// APP_CMD
+#define CMD58	58		// READ_OCR
+#define ACMD23	23		// SET_WR_BLK_ERASE_COUNT
+#define ACMD41	41		// SD_SEND_OP_COND
+
+// SD Card Tokens for Multiple Block Write
+#define START_BLK_TOK	0xFC	// 'Start Block' token
+#define STOP_TRANS_TOK	0xFD	// 'Stop Tran' token (stop transmission)
+
+// SD Card type flags (CardType)
+#define CT_MMC				0x01			// MMC ver 3
+#define CT_SD1				0x02			// SD ver 1
+#define CT_SD2				0x04			// SD ver 2
+#define CT_SDC				(CT_SD1|CT_SD2)	// SD
+#define CT_BLOCK			0x08			// Block addressing
+
+// Lowest FAT entry value marking the end of a cluster chain
+#define FAT_EOC				0xFFF8
+
+// Offset marking the FAT cache as empty
+#define FAT_CACHE_EMPTY		0xFFFFFFFF
+
+// Results of write_poll()
+#define SD_READY			0				// Card done programming
+#define SD_BUSY				1				// Card still programming
+#define SD_TIMEOUT			2				// Card busy for too long
+
+// Number of polls of a busy card before a write is given up.  A poll is one
+// byte on the bus and takes about 3.3 us with the SPI clock at 6 MHz, so this
+// is about 500 ms, the longest write busy time allowed to SDHC cards.  Time
+// spent between calls to write_poll() is not counted.
+#ifndef SD_BUSY_POLLS
+#define SD_BUSY_POLLS		150000
+#endif
+
+// Shortest multiple block write given a pre-erase hint (see
+// write_multiple_start()): for fewer blocks, the two commands of the hint
+// (CMD55, ACMD23) take longer than the erase they save
+#ifndef SD_HINT_BLOCKS
+#define SD_HINT_BLOCKS		8
+#endif
+
+// Set to 0 to take sector sizes from the boot sector in all arithmetic.  By
+// default, sectors are fixed at 512 bytes (parse_boot_sector() rejects other
+// sizes anyway) and the cluster size is a power of two, so remainders and
+// quotients are masks and shifts instead of runtime library divisions.
+#ifndef SDFAT_SECT512
+#define SDFAT_SECT512	1
+#endif
+
+// Set to 1 to move the data bytes of blocks with DMA (see spi.c), the CPU
+// sleeping in LPM0 meanwhile, instead of the CPU's burst loops
+#ifndef SDFAT_DMA
+#define SDFAT_DMA		0
+#endif
+
+// Divisions that are runtime library calls on the MSP430, which has no
+// divider: 32-bit division and remainder, signed 32-bit division and 16-bit
+// division and remainder.  Divisions by a constant power of two compile to
+// shifts and masks, and need not go through these.
+#ifndef DIV32
+#define DIV32(a, b)		((uint32_t)(a) / (b))
+#define MOD32(a, b)		((uint32_t)(a) % (b))
+#define SDIV32(a, b)	((int32_t)(a) / (b))
+#define DIV16(a, b)		((uint16_t)(a) / (b))
+#define MOD16(a, b)		((uint16_t)(a) % (b))
+#endif
+
+#if SDFAT_SECT512
+#define SECT_REM(x, info)	((uint16_t)(x) & 0x1FF)			// x % sector size
+#define CLUST_QUOT(x, info)	((uint32_t)(x) >> (info)->clustshift)
+#else
+#define SECT_REM(x, info)	((uint16_t)MOD32((x), (info)->nbytesinsect))
+#define CLUST_QUOT(x, info)	DIV32((x), (info)->nbytesinclust)
+#endif
+
+#define CS_LOW_SD()  P4OUT &= ~(0x80)		// Card Select (P4.7)
+#define CS_HIGH_SD() P4OUT |= 0x80			// Card Deselect (P4.7)
+
+struct fatstruct {					// FAT information based on boot sector
+	uint16_t nbytesinsect;			// Number of bytes per sector, should be 512
+	uint8_t nsectsinclust;			// Number of sectors per cluster
+	uint32_t nbytesinclust;			// bytes per sector * sectors per cluster
+	uint8_t clustshift;				// log2(nbytesinclust)
+	uint16_t nressects;				// Number of reserved sectors from offset 0
+	uint16_t nsectsinfat;			// Number of sectors per FAT 
+	uint8_t nfats;					// Number of FATs
+	uint32_t fatsize;				// Number of bytes per FAT 
+	uint32_t fatoffset;				// Offset of the first FAT 
+	uint32_t dtoffset;				// Offset of the directory table
+	uint32_t dtsize;				// Size of directory table in bytes
+	uint32_t nsects;				// Number of sectors in the partition
+	uint32_t fileclustoffset;		// Offset of the first cluster for file data
+	uint32_t nhidsects;				// Number of hidden sectors
+// Offset of the boot record sector, determined by number of hidden sectors
+	uint32_t bootoffset;
+	uint16_t nclusts;				// Highest cluster number + 1
+/* Free space, kept by scan_fat() at mount and updated on allocation */
+	uint16_t nfreeclusts;			// Number of free clusters
+	uint16_t nextfree;				// Cluster to resume the free search at
+/* Directory index, kept by scan_dir() at mount and updated on each entry */
+	uint16_t nextfilenum;			// Next file number suffix
+	uint32_t freeentry;				// First free entry (byte offset into the
+									// directory table), dtsize if full
+};
+
+uint8_t init_sd(void);
+void go_idle_sd(void);
+uint8_t send_cmd_sd(uint8_t cmd, uint32_t arg);
+uint8_t send_acmd_sd(uint8_t acmd, uint32_t arg);
+uint8_t write_multiple_start(uint32_t start_offset, uint32_t nblocks);
+uint8_t write_multiple_send(uint8_t *data);
+uint8_t write_multiple_block(uint8_t *data);
+uint8_t write_multiple_stop(void);
+uint8_t write_multiple_end(void);
+uint8_t check_status_sd(void);
+uint8_t wait_notbusy(void);
+uint8_t write_poll(void);
+uint8_t write_wait(void);
+void send_block_data(const uint8_t *data, uint16_t count);
+void rec_block_data(uint8_t *data, uint16_t count);
+uint8_t write_block_start(uint8_t *data, uint32_t offset, uint16_t count);
+uint8_t write_block_complete(void);
+uint8_t write_block(uint8_t *data, uint32_t offset, uint16_t count);
+uint8_t read_block(uint8_t *data, uint32_t offset);
+uint8_t read_multiple_start(uint32_t start_offset);
+uint8_t read_multiple_block(uint8_t *data);
+uint8_t read_multiple_stop(void);
+uint8_t copy_blocks(	uint8_t *data, uint16_t nbuf,
+						uint32_t src_offset, uint32_t dst_offset,
+						uint32_t nblocks);
+uint8_t load_fat_sector(struct fatstruct *, uint32_t offset);
+uint8_t flush_fat(struct fatstruct *);
+uint8_t scan_fat(uint8_t *data, struct fatstruct *);
+uint8_t *read_fat_sector(uint8_t *data, uint32_t offset);
+uint16_t find_cluster(uint8_t *data, struct fatstruct *);
+uint16_t alloc_extent(uint8_t *data, struct fatstruct *, uint16_t n);
+uint32_t get_cluster_offset(uint16_t clust, struct fatstruct *);
+uint8_t valid_block(uint8_t block, struct fatstruct *);
+uint16_t next_cluster(struct fatstruct *, uint16_t clust);
+uint8_t update_fat(struct fatstruct *, uint32_t, uint16_t);
+uint8_t update_dir_table(	uint8_t *data, struct fatstruct *,
+							uint16_t, uint32_t, uint16_t);
+uint8_t add_dir_entry(uint8_t *data, struct fatstruct *, uint8_t *entry);
+uint32_t find_dir_entry(uint8_t *data, struct fatstruct *,
+						const uint8_t *name);
+uint16_t open_file(	uint8_t *data, struct fatstruct *,
+					const uint8_t *name, uint8_t attr, uint16_t nclusts,
+					uint32_t *dteoffset);
+uint8_t read_boot_sector(uint8_t *data, struct fatstruct *);
+uint8_t parse_boot_sector(uint8_t *data, struct fatstruct *);
+uint8_t scan_dir(uint8_t *data, struct fatstruct *);
+uint16_t get_file_num(struct fatstruct *);
+//void format_sd(uint8_t *data);
+
 #endif
\ No newline at end of file
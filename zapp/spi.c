@@ -1,57 +1,188 @@
-/**
- * Written by Tim Johns.
- *
- * The function bodies in this file are specific to MSP430F5310.
- */
-
-#ifndef _SPILIB_C
-#define _SPILIB_C
-
-#include <msp430f5310.h>
-#include <stdint.h>
-#include "spi.h"
-
-/*----------------------------------------------------------------------------*/
-/* Set up SPI for master (MCU) and slaves									  */
-/*----------------------------------------------------------------------------*/
-void spi_config(void) {
-
-/* Set up ports for SPI. Remember to change the values for a new circuit
-design. */
-	P4SEL |= BIT0 | BIT4 | BIT5;	// P4.0,4,5 USCI_A1 SPI option select
-	P4DIR |= BIT4;					// P4.4 output direction (UCA1SIMO)
-	P4DIR &= ~BIT5;					// P4.5 input direction (UCA1SOMI)
-	P4DIR |= BIT7;					// P4.7 output direction (SD Card CS)
-	P4OUT |= BIT7;					// P4.7 high (SD Card CS)
-
-/* Set up USCI_A1 SPI */
-// Clock polarity high, MSB first, master, 3-pin SPI, synchronous
-	UCA1CTL0 = UCCKPL | UCMSB | UCMST | UCMODE_0 | UCSYNC;
-// Clock source SMCLK, set reset bit high
-	UCA1CTL1 = UCSSEL__SMCLK | UCSWRST;
-    UCA1BR1 = 0;					// Upper byte of divider word
-	UCA1BR0 = 2;					// Clock = SMCLK / 2
-    UCA1CTL1 &= ~UCSWRST;			// Release from reset
-}
-
-/*----------------------------------------------------------------------------*/
-/* Transmit byte to USCI_A1 SPI slave and return received byte				  */
-/*----------------------------------------------------------------------------*/
-uint8_t spia_send(const uint8_t b) {
-	while ((UCA1IFG & UCTXIFG) == 0);	// Wait while not ready
-	UCA1TXBUF = b;						// Transmit
-	while ((UCA1IFG & UCRXIFG) == 0);	// Wait for RX buffer (full)
-	return (UCA1RXBUF);
-}
-
-/*----------------------------------------------------------------------------*/
-/* Receive and return byte from USCI_A1 SPI slave							  */
-/*----------------------------------------------------------------------------*/
-uint8_t spia_rec(void) {
-	while ((UCA1IFG & UCTXIFG) == 0);	// Wait while not ready
-	UCA1TXBUF = 0xFF;					// Dummy byte to start SPI
-	while ((UCA1IFG & UCRXIFG) == 0);	// Wait for RX buffer (full)
-	return (UCA1RXBUF);
-}
-
-#endif
\ No newline at end of file
+/**
+ * Written by Tim Johns.
+ *
+ * The function bodies in this file are specific to MSP430F5310.
+ */
+
+#ifndef _SPILIB_C
+#define _SPILIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "spi.h"
+
+/*----------------------------------------------------------------------------*/
+/* Set up SPI for master (MCU) and slaves									  */
+/*----------------------------------------------------------------------------*/
+void spi_config(void) {
+
+/* Set up ports for SPI. Remember to change the values for a new circuit
+design. */
+	P4SEL |= BIT0 | BIT4 | BIT5;	// P4.0,4,5 USCI_A1 SPI option select
+	P4DIR |= BIT4;					// P4.4 output direction (UCA1SIMO)
+	P4DIR &= ~BIT5;					// P4.5 input direction (UCA1SOMI)
+	P4DIR |= BIT7;					// P4.7 output direction (SD Card CS)
+	P4OUT |= BIT7;					// P4.7 high (SD Card CS)
+
+/* Set up USCI_A1 SPI */
+// Clock polarity high, MSB first, master, 3-pin SPI, synchronous
+	UCA1CTL0 = UCCKPL | UCMSB | UCMST | UCMODE_0 | UCSYNC;
+// Clock source SMCLK, set reset bit high
+	UCA1CTL1 = UCSSEL__SMCLK | UCSWRST;
+    UCA1BR1 = 0;					// Upper byte of divider word
+	UCA1BR0 = 2;					// Clock = SMCLK / 2
+    UCA1CTL1 &= ~UCSWRST;			// Release from reset
+}
+
+/*----------------------------------------------------------------------------*/
+/* Transmit byte to USCI_A1 SPI slave and return received byte				  */
+/*----------------------------------------------------------------------------*/
+uint8_t spia_send(const uint8_t b) {
+	while ((UCA1IFG & UCTXIFG) == 0);	// Wait while not ready
+	UCA1TXBUF = b;						// Transmit
+	while ((UCA1IFG & UCRXIFG) == 0);	// Wait for RX buffer (full)
+	return (UCA1RXBUF);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Receive and return byte from USCI_A1 SPI slave							  */
+/*----------------------------------------------------------------------------*/
+uint8_t spia_rec(void) {
+	while ((UCA1IFG & UCTXIFG) == 0);	// Wait while not ready
+	UCA1TXBUF = 0xFF;					// Dummy byte to start SPI
+	while ((UCA1IFG & UCRXIFG) == 0);	// Wait for RX buffer (full)
+	return (UCA1RXBUF);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Transmit count bytes to USCI_A1 SPI slave, discarding the received bytes	  */
+/* The TX buffer is refilled as soon as it empties, so bytes go out back to	  */
+/* back; RX is only cleared after the last byte (its overrun flag is set by	  */
+/* then, and reading UCA1RXBUF clears it).									  */
+/*----------------------------------------------------------------------------*/
+void spia_send_burst(const uint8_t *buf, uint16_t count) {
+	while (count--) {
+		while ((UCA1IFG & UCTXIFG) == 0);	// Wait for TX buffer (empty)
+		UCA1TXBUF = *buf++;					// Transmit
+	}
+	while (UCA1STAT & UCBUSY);			// Wait for last byte to shift out
+	(void)UCA1RXBUF;					// Clear RX flag and overrun flag
+}
+
+/*----------------------------------------------------------------------------*/
+/* Receive count bytes from USCI_A1 SPI slave into buf						  */
+/* The next dummy byte is queued before each received byte is read, so the	  */
+/* bus does not idle between bytes.  Interrupts are held off from queueing a  */
+/* byte to reading the previous one (at most a byte time), since an interrupt*/
+/* there could let two bytes arrive and overrun the RX buffer.				  */
+/*----------------------------------------------------------------------------*/
+void spia_rec_burst(uint8_t *buf, uint16_t count) {
+	__istate_t s;
+
+	if (count == 0) return;
+
+	while ((UCA1IFG & UCTXIFG) == 0);	// Wait while not ready
+	UCA1TXBUF = 0xFF;					// Dummy byte to start SPI
+	while (--count) {
+		while ((UCA1IFG & UCTXIFG) == 0);	// Wait for TX buffer (empty)
+		s = __get_interrupt_state();
+		__disable_interrupt();
+		UCA1TXBUF = 0xFF;					// Queue next dummy byte
+		while ((UCA1IFG & UCRXIFG) == 0);	// Wait for RX buffer (full)
+		*buf++ = UCA1RXBUF;
+		__set_interrupt_state(s);
+	}
+	while ((UCA1IFG & UCRXIFG) == 0);	// Wait for last byte
+	*buf = UCA1RXBUF;
+}
+
+/*----------------------------------------------------------------------------*/
+/* DMA block transfers														  */
+/*																			  */
+/* DMA0 drains UCA1RXBUF and DMA1 feeds UCA1TXBUF (the RX channel has the	  */
+/* higher priority, so a received byte is always read before the next one	  */
+/* can arrive).  The first byte is written by the CPU; each following byte	  */
+/* is triggered by UCTXIFG as the previous one moves to the shift register.	  */
+/* The transfer is complete when DMA0 has read the last byte, which raises	  */
+/* the DMA interrupt (shared with the sample capture, see main.c).			  */
+/*----------------------------------------------------------------------------*/
+	volatile uint8_t spia_dma_active = 0;	// Set while a transfer is running
+	const uint8_t spia_dma_fill = 0xFF;		// Sent when there is no TX data
+	uint8_t spia_dma_sink;					// Received when RX is discarded
+
+/*----------------------------------------------------------------------------*/
+/* Start a DMA transfer of count bytes (count > 0) on USCI_A1				  */
+/* tx: bytes to send, or 0 to send 0xFF										  */
+/* rx: buffer for the received bytes, or 0 to discard them					  */
+/*----------------------------------------------------------------------------*/
+void spia_dma_start(const uint8_t *tx, uint8_t *rx, uint16_t count) {
+	DMA0CTL = 0;							// Disable both channels
+	DMA1CTL = 0;
+	DMACTL0 = (DMA_TRIG_UCA1TX << 8) | DMA_TRIG_UCA1RX;
+
+/* DMA0: UCA1RXBUF to rx (or the sink) */
+	__data16_write_addr((unsigned short)&DMA0SA,
+		(unsigned long)&UCA1RXBUF);
+	__data16_write_addr((unsigned short)&DMA0DA,
+		(unsigned long)(rx ? rx : &spia_dma_sink));
+	DMA0SZ = count;
+	DMA0CTL = DMADT_0 | (rx ? DMADSTINCR_3 : DMADSTINCR_0) |
+		DMASRCBYTE | DMADSTBYTE | DMAIE | DMAEN;
+
+	(void)UCA1RXBUF;						// Clear RX flag and overrun flag
+	spia_dma_active = 1;
+
+/* DMA1: tx (or the fill byte) to UCA1TXBUF, after the first byte */
+	if (count > 1) {
+		__data16_write_addr((unsigned short)&DMA1SA,
+			(unsigned long)(tx ? tx + 1 : &spia_dma_fill));
+		__data16_write_addr((unsigned short)&DMA1DA,
+			(unsigned long)&UCA1TXBUF);
+		DMA1SZ = count - 1;
+		DMA1CTL = DMADT_0 | (tx ? DMASRCINCR_3 : DMASRCINCR_0) |
+			DMASRCBYTE | DMADSTBYTE | DMAEN;
+	}
+
+	while ((UCA1IFG & UCTXIFG) == 0);		// Wait while not ready
+	UCA1TXBUF = tx ? tx[0] : 0xFF;			// First byte starts the transfer
+}
+
+/*----------------------------------------------------------------------------*/
+/* Return 1 while a DMA transfer is running									  */
+/*----------------------------------------------------------------------------*/
+uint8_t spia_dma_busy(void) {
+	return spia_dma_active;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Wait for the DMA transfer to complete									  */
+/* With interrupts enabled, the CPU sleeps in LPM0 until the DMA interrupt	  */
+/* (other interrupts are still served).  With interrupts disabled, the		  */
+/* completion flag is polled instead.										  */
+/*----------------------------------------------------------------------------*/
+void spia_dma_wait(void) {
+	__istate_t s = __get_interrupt_state();
+
+	if (s & GIE) {
+		__disable_interrupt();
+		while (spia_dma_active) {
+			__bis_SR_register(LPM0_bits | GIE);	// Sleep, interrupts on
+			__disable_interrupt();
+		}
+		__set_interrupt_state(s);
+	} else {
+		while (spia_dma_active && (DMA0CTL & DMAIFG) == 0);
+		DMA0CTL &= ~(DMAIFG | DMAIE);
+		spia_dma_active = 0;
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+/* End the DMA transfer, from the DMA interrupt (see DMA_ISR() in main.c),	  */
+/* which then wakes up spia_dma_wait()										  */
+/*----------------------------------------------------------------------------*/
+void spia_dma_done(void) {
+	spia_dma_active = 0;
+}
+
+#endif
@@ -1,12 +1,22 @@
-/**
- * Written by Tim Johns.
- */
-
-#ifndef _SPILIB_H
-#define _SPILIB_H
-
-void spi_config(void);
-uint8_t spia_send(uint8_t b);
-uint8_t spia_rec(void);
-
+/**
+ * Written by Tim Johns.
+ */
+
+#ifndef _SPILIB_H
+#define _SPILIB_H
+
+// DMA trigger sources (MSP430F5310 datasheet, DMA trigger assignments)
+#define DMA_TRIG_UCA1RX		20			// UCA1RXIFG
+#define DMA_TRIG_UCA1TX		21			// UCA1TXIFG
+
+void spi_config(void);
+uint8_t spia_send(uint8_t b);
+uint8_t spia_rec(void);
+void spia_send_burst(const uint8_t *buf, uint16_t count);
+void spia_rec_burst(uint8_t *buf, uint16_t count);
+void spia_dma_start(const uint8_t *tx, uint8_t *rx, uint16_t count);
+uint8_t spia_dma_busy(void);
+void spia_dma_wait(void);
+void spia_dma_done(void);
+
 #endif
\ No newline at end of file
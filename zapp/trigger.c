@@ -0,0 +1,47 @@
+/**
+ * Event trigger for unattended recording.
+ *
+ * Each full slot of the sector ring is checked against TRIG_LEVEL and
+ * TRIG_PEAK from the level the capture library measures as the samples come
+ * in (see capt_level()).  A slot above either is an event: TRIG_POST slots
+ * later, the recorder bookmarks a clip as it does on a tap, so the clip holds
+ * the TRIG_POST slots following the event and the slots leading to it.  For
+ * TRIG_HOLDOFF slots from the event, other events are ignored.
+ *
+ * The trigger costs two comparisons and two counters per slot.
+ */
+
+#ifndef _TRIGLIB_C
+#define _TRIGLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "sdfat.h"
+#include "adpcm.h"
+#include "capture.h"
+#include "trigger.h"
+
+/*----------------------------------------------------------------------------*/
+/* Start a recording with no event seen yet									  */
+/*----------------------------------------------------------------------------*/
+void trig_reset(struct trigstate *trig) {
+	trig->holdoff = 0;
+	trig->wait = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Check the next slot, of given level										  */
+/* Return 1 if a clip is to be bookmarked after this slot, 0 otherwise.		  */
+/*----------------------------------------------------------------------------*/
+uint8_t trig_step(struct trigstate *trig, const struct captlevel *lvl) {
+	if (trig->holdoff) trig->holdoff--;
+	if (trig->holdoff == 0 &&
+		(lvl->level > TRIG_LEVEL || lvl->peak > TRIG_PEAK)) {
+		trig->holdoff = TRIG_HOLDOFF;
+		trig->wait = TRIG_POST + 1;	// Counting this slot
+	}
+	if (trig->wait == 0) return 0;
+	return --trig->wait == 0;
+}
+
+#endif
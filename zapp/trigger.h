@@ -0,0 +1,56 @@
+/**
+ * Event trigger library.
+ */
+
+#ifndef _TRIGLIB_H
+#define _TRIGLIB_H
+
+// Set to save clips on events as well as on taps (see start_logging())
+#ifndef TRIG_ENABLE
+#define TRIG_ENABLE		1
+#endif
+
+// A slot is an event when its level (mean deviation, see capt_level()) is
+// above TRIG_LEVEL or its peak above TRIG_PEAK, in 16-bit units: a sustained
+// sound at -18 dBFS or a bang at -6 dBFS, well above speech at a distance
+#ifndef TRIG_LEVEL
+#define TRIG_LEVEL		0x1000
+#endif
+#ifndef TRIG_PEAK
+#define TRIG_PEAK		0x4000
+#endif
+
+// Slots in a time in ms (rounded up)
+#define TRIG_SLOTS(ms)	\
+	(((ms) * (uint32_t)CAPT_RATE / 1000 + CAPT_SLOT_SAMPLES - 1) / \
+	CAPT_SLOT_SAMPLES)
+
+// Post-trigger window: time recorded after the event before the clip is
+// bookmarked, so the clip holds the event's aftermath as well as the
+// pre-trigger window leading to it (the rest of the clip's length)
+#ifndef TRIG_POST_MS
+#define TRIG_POST_MS	2000
+#endif
+#define TRIG_POST		TRIG_SLOTS(TRIG_POST_MS)
+
+// Hold-off: time after an event during which other events are ignored, so a
+// long or repeated sound saves one clip and the card is not filled with them
+// (at least the post-trigger window)
+#ifndef TRIG_HOLDOFF_MS
+#define TRIG_HOLDOFF_MS	10000
+#endif
+#define TRIG_HOLDOFF	TRIG_SLOTS(TRIG_HOLDOFF_MS)
+
+#if TRIG_HOLDOFF_MS < TRIG_POST_MS
+#error "TRIG_HOLDOFF_MS must be at least TRIG_POST_MS"
+#endif
+
+struct trigstate {					// Trigger state, one per recording
+	uint16_t holdoff;				// Slots left before events count again
+	uint16_t wait;					// Slots left before the bookmark (0 if none)
+};
+
+void trig_reset(struct trigstate *);
+uint8_t trig_step(struct trigstate *, const struct captlevel *);
+
+#endif
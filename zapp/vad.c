@@ -0,0 +1,45 @@
+/**
+ * Energy-based voice activity detection.
+ *
+ * Each full slot of the sector ring is classified from its level, which the
+ * capture library measures as the samples come in (the mean deviation from
+ * the previous slot's mean, so a DC offset at the input does not count): a
+ * slot above VAD_LEVEL is active, and the VAD_HANGOVER slots following the
+ * last active one are kept as well.  Any other slot is silent, and the
+ * recorder does not write it (see CIRC_GATE).
+ *
+ * The detector costs one comparison per slot.
+ */
+
+#ifndef _VADLIB_C
+#define _VADLIB_C
+
+#include <msp430f5310.h>
+#include <stdint.h>
+#include "sdfat.h"
+#include "adpcm.h"
+#include "capture.h"
+#include "vad.h"
+
+/*----------------------------------------------------------------------------*/
+/* Start a recording with no active slot seen yet							  */
+/*----------------------------------------------------------------------------*/
+void vad_reset(struct vadstate *vad) {
+	vad->hang = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Classify the next slot, of given level									  */
+/* Return 1 if the slot is silent, 0 if it is to be kept.					  */
+/*----------------------------------------------------------------------------*/
+uint8_t vad_silent(struct vadstate *vad, const struct captlevel *lvl) {
+	if (lvl->level > VAD_LEVEL) {
+		vad->hang = VAD_HANGOVER;
+		return 0;
+	}
+	if (vad->hang == 0) return 1;
+	vad->hang--;
+	return 0;
+}
+
+#endif
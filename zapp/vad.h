@@ -0,0 +1,29 @@
+/**
+ * Voice activity detection library.
+ */
+
+#ifndef _VADLIB_H
+#define _VADLIB_H
+
+// A slot is active when its level (mean deviation, see capt_level()) is above
+// VAD_LEVEL, in 16-bit units: 256 is 4 steps of the 10-bit ADC (-42 dBFS),
+// well above the noise of a quiet room and well below speech nearby
+#ifndef VAD_LEVEL
+#define VAD_LEVEL		256
+#endif
+
+// Time kept after the last active slot, so that the ends of words and the
+// pauses between them are not cut, in ms and in slots (rounded up)
+#define VAD_HANGOVER_MS	500
+#define VAD_HANGOVER	\
+	((VAD_HANGOVER_MS * (uint32_t)CAPT_RATE / 1000 + CAPT_SLOT_SAMPLES - 1) / \
+	CAPT_SLOT_SAMPLES)
+
+struct vadstate {					// Detector state, one per recording
+	uint16_t hang;					// Slots still kept after the last active one
+};
+
+void vad_reset(struct vadstate *);
+uint8_t vad_silent(struct vadstate *, const struct captlevel *);
+
+#endif
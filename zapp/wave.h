@@ -1,38 +1,51 @@
-/**
- * Written by Tim Johns.
- * 
- * WAVE file format library.
- */
-
-#ifndef _WAVELIB_H
-#define _WAVELIB_H
-
-#define WAVE_FORMAT_PCM		0x0001	// PCM
-
-struct ck {							// Chunk structure
-	uint8_t		ckid[4];			// Chunk type identifier (big-endian)
-	uint32_t	cksize;				// Chunk size field
-};
-
-struct ckriff {
-	struct ck	info;				// Chunk info
-	uint8_t		format[4];			// RIFF format (big-endian)
-};
-
-struct ckfmt {
-	struct ck	info;				// Chunk info
-	uint16_t	format;				// Waveform-audio format type (1 for PCM)
-	uint16_t	nchannels;			// Number of channels
-	uint32_t	nsamplerate;		// Sample rate (Hz)
-// Average data-transfer rate, in bytes per second
-// (for PCM, navgrate = nsamplerate * nblockalign)
-	uint32_t	navgrate;
-// Block alignment, in bytes
-// (for PCM, nblockalign = nchannels * bits)
-	uint16_t	nblockalign;
-	uint16_t	bits;				// Bits per sample
-};
-
-void write_header(uint8_t *, struct ckriff *, struct ckfmt *, struct ck *);
-
+/**
+ * Written by Tim Johns.
+ * 
+ * WAVE file format library.
+ */
+
+#ifndef _WAVELIB_H
+#define _WAVELIB_H
+
+#define WAVE_FORMAT_PCM		0x0001	// PCM
+#define WAVE_FORMAT_MULAW	0x0007	// G.711 mu-law
+#define WAVE_FORMAT_IMA_ADPCM	0x0011	// IMA ADPCM
+
+struct ck {							// Chunk structure
+	uint8_t		ckid[4];			// Chunk type identifier (big-endian)
+	uint32_t	cksize;				// Chunk size field
+};
+
+struct ckriff {
+	struct ck	info;				// Chunk info
+	uint8_t		format[4];			// RIFF format (big-endian)
+};
+
+struct ckfmt {
+	struct ck	info;				// Chunk info
+	uint16_t	format;				// Waveform-audio format type (1 for PCM)
+	uint16_t	nchannels;			// Number of channels
+	uint32_t	nsamplerate;		// Sample rate (Hz)
+// Average data-transfer rate, in bytes per second
+// (for PCM, navgrate = nsamplerate * nblockalign)
+	uint32_t	navgrate;
+// Block alignment, in bytes
+// (for PCM, nblockalign = nchannels * bits)
+	uint16_t	nblockalign;
+	uint16_t	bits;				// Bits per sample
+// Extension of formats other than PCM: cbsize is only written if the chunk
+// size is 18 or more, nsamplesperblock if it is 20 (for IMA ADPCM)
+	uint16_t	cbsize;				// Size of the extension that follows
+	uint16_t	nsamplesperblock;	// Samples per block
+};
+
+struct ckfact {						// Sample count of compressed audio
+	struct ck	info;				// Chunk info
+	uint32_t	nsamples;			// Samples in the data chunk
+};
+
+uint16_t write_header(uint8_t *, struct ckriff *, struct ckfmt *, struct ck *);
+void write_chunk(uint8_t *, struct ck *);
+void write_fact(uint8_t *, struct ckfact *);
+
 #endif
\ No newline at end of file